@@ -0,0 +1,86 @@
+// Runs each binding of an addon in a loop and fails when it costs more per call than its budget.
+// Usage: node leak-harness.js [path to leaks.node]
+//
+// Per call, after a warm-up and with a full GC either side of the timed loop:
+//   refs, wrapped   growth in the library's live reference / wrapped instance counts (leaks::stats, with NODE_LEAK_COUNTS)
+//   heapBytes       growth in V8's used heap
+//   ns              time
+// and no handle scope may be left open afterwards.
+// run() can be required to gate other addons: pass their exports and a case list like the one below.
+
+'use strict';
+const v8	= require('v8');
+const vm	= require('vm');
+
+v8.setFlagsFromString('--expose-gc');
+const gc	= vm.runInNewContext('gc');
+
+const defaults = { iterations: 100000, warmup: 1000, refs: 0, wrapped: 0, heapBytes: 16, ns: Infinity };
+
+// napi finalizers run from a later task, so collect twice around a turn of the event loop
+async function settle() {
+	for (let i = 0; i < 2; i++) {
+		gc();
+		await new Promise(resolve => setImmediate(resolve));
+	}
+}
+
+function sample(addon) {
+	const s = addon.leakStats ? addon.leakStats() : { enabled: false, refs: 0, scopes: 0, wrapped: 0 };
+	return { ...s, heap: v8.getHeapStatistics().used_heap_size };
+}
+
+async function measure(addon, c) {
+	const o = { ...defaults, ...c };
+	for (let i = 0; i < o.warmup; i++)
+		c.call(i);
+	await settle();
+	const before = sample(addon);
+	const start = process.hrtime.bigint();
+	for (let i = 0; i < o.iterations; i++)
+		c.call(i);
+	const ns = Number(process.hrtime.bigint() - start) / o.iterations;
+	await settle();
+	const after = sample(addon);
+
+	const per = {
+		refs:		(after.refs - before.refs) / o.iterations,
+		wrapped:	(after.wrapped - before.wrapped) / o.iterations,
+		heapBytes:	(after.heap - before.heap) / o.iterations,
+		ns,
+	};
+	const over = ['refs', 'wrapped', 'heapBytes', 'ns'].filter(k => per[k] > o[k]);
+	if (after.scopes !== 0)
+		over.push('scopes');
+	return { name: c.name, per, scopes: after.scopes, over, counted: after.enabled };
+}
+
+// cases: [{name, call(i), iterations?, warmup?, refs?, wrapped?, heapBytes?, ns?, leaks?}]
+// a case with leaks: true is expected to go over budget, which checks the harness itself can see a leak
+async function run(addon, cases, log = console.log) {
+	let failed = 0;
+	for (const c of cases) {
+		const r = await measure(addon, c);
+		const ok = c.leaks ? r.over.length > 0 : r.over.length === 0;
+		if (!ok)
+			++failed;
+		log(`${ok ? 'ok  ' : 'FAIL'} ${r.name.padEnd(16)} refs ${r.per.refs.toFixed(3)}  wrapped ${r.per.wrapped.toFixed(3)}  heap ${r.per.heapBytes.toFixed(1)}B  ${r.per.ns.toFixed(0)}ns`
+			+ (r.over.length ? `  over: ${r.over.join(', ')}` : '')
+			+ (r.counted ? '' : '  (no library counts: built without NODE_LEAK_COUNTS)'));
+	}
+	return failed;
+}
+
+module.exports = { run, measure, defaults };
+
+if (require.main === module) {
+	const addon	= require(require('path').resolve(process.argv[2] || './leaks.node'));
+	const obj	= { x: 1 };
+	const arr	= Array.from({ length: 1000 }, (_, i) => i);
+	run(addon, [
+		{ name: 'PinAndRelease',	call: () => addon.PinAndRelease(obj) },
+		{ name: 'SumScoped',		call: () => addon.SumScoped(arr), iterations: 2000 },
+		{ name: 'MakeCounter',		call: i => addon.MakeCounter(i), heapBytes: 64 },
+		{ name: 'PinAndLeak',		call: () => addon.PinAndLeak(obj), leaks: true },
+	]).then(failed => process.exit(failed ? 1 : 0));
+}
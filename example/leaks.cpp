@@ -0,0 +1,64 @@
+//	addon for leak-harness.js: each binding exercises one kind of resource the library owns
+//	leak counts are enabled here, ahead of node.h, so leaks::stats() has counts to report; build it eg. on Linux:
+//	g++ -std=c++17 -O2 -shared -fPIC -I../include -I<node headers> -DNODE_GYP_MODULE_NAME=leaks leaks.cpp -o leaks.node
+
+#define NODE_LEAK_COUNTS	1
+#include "node.h"
+
+using namespace Node;
+
+class Counter {
+	int	n;
+public:
+	Counter(int n) : n(n) {}
+	int		next()	{ return n++; }
+};
+
+template<> Constructor Node::define<Counter>() {
+	return ClassDefinition<Counter, int>("Counter", {
+		{"next", property_maker<decltype(&Counter::next)>::make<&Counter::next>()},
+	});
+}
+
+// a reference created and dropped every call
+double	PinAndRelease(object o) {
+	ref	r(o);
+	return number(value(object(*r)["x"]));
+}
+
+// a cache that only ever grows: one more live reference every call
+std::vector<ref>	cache;
+double	PinAndLeak(object o) {
+	cache.emplace_back(o);
+	return number(value(o["x"]));
+}
+
+// a native loop that makes a handle per element, inside a chunked scope
+double	SumScoped(array a) {
+	double	total = 0;
+	map_scoped(a, [&](value v) {
+		total += double(number(v));
+		return v;
+	});
+	return total;
+}
+
+// a new wrapped instance every call, freed when JS drops it
+int		MakeCounter(int start) {
+	return Class<Counter>::newInstance(start)->next();
+}
+
+napi_value Init(napi_env env, napi_value exports) {
+	global_env	= env;
+
+	object(exports).defineProperties({
+		{"PinAndRelease",	function::make<PinAndRelease>()},
+		{"PinAndLeak",		function::make<PinAndLeak>()},
+		{"SumScoped",		function::make<SumScoped>()},
+		{"MakeCounter",		function::make<MakeCounter>()},
+		{"leakStats",		function::make<leaks::stats>()},
+	});
+	return exports;
+}
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, Init)
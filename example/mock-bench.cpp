@@ -0,0 +1,122 @@
+//	times the library's own layer - trampolines, node_type conversions and api checking - against the mock host in mock.h, with no Node process
+//	what is left after subtracting the raw napi baseline is what node.h adds per call; the JS engine's share is not measured here
+//	build it as a plain executable, eg. on Linux:
+//	g++ -std=c++17 -O2 -I../include -I<node headers> mock-bench.cpp -o mock-bench
+
+#include "node.h"
+#include "mock.h"
+#include <algorithm>
+#include <chrono>
+
+using namespace Node;
+
+int		Add(int a, int b)				{ return a + b; }
+double	Scale(double x)					{ return x * 2; }
+std::string	Greet(std::string name)		{ return "hello " + name; }
+double	Sum(array a) {
+	double	total = 0;
+	for (size_t i = 0, n = a.length(); i < n; i++)
+		total += double(number(value(a[i])));
+	return total;
+}
+
+class Point {
+	double	x, y;
+public:
+	Point(double x, double y) : x(x), y(y) {}
+	double	length()	{ return std::sqrt(x * x + y * y); }
+};
+
+template<> Constructor Node::define<Point>() {
+	return ClassDefinition<Point, double, double>("Point", {
+		{"length", property_maker<decltype(&Point::length)>::make<&Point::length>()},
+	});
+}
+
+// the same as Add, straight onto napi
+napi_value	RawAdd(napi_env env, napi_callback_info info) {
+	size_t		argc = 2;
+	napi_value	argv[2], r;
+	int32_t		a, b;
+	napi_get_cb_info(env, info, &argc, argv, nullptr, nullptr);
+	napi_get_value_int32(env, argv[0], &a);
+	napi_get_value_int32(env, argv[1], &b);
+	napi_create_int32(env, a + b, &r);
+	return r;
+}
+
+napi_value Init(napi_env env, napi_value exports) {
+	global_env	= env;
+
+	object(exports).defineProperties({
+		{"Add",		function::make<Add>()},
+		{"Scale",	function::make<Scale>()},
+		{"Greet",	function::make<Greet>()},
+		{"Sum",		function::make<Sum>()},
+		{"RawAdd",	function("RawAdd", callback{RawAdd, nullptr})},
+		{"Point",	Class<Point>::constructor()},
+	});
+	return exports;
+}
+
+// ns per call of f over n calls, inside a scope per batch so handles do not pile up
+template<typename F> double	run(F &&f, int n) {
+	using clock = std::chrono::steady_clock;
+	auto	start = clock::now();
+	for (int i = 0; i < n; i += 1000) {
+		scope	s;
+		for (int j = 0; j < 1000; j++)
+			f(i + j);
+	}
+	return std::chrono::duration<double, std::nano>(clock::now() - start).count() / n;
+}
+
+// best ns per call of f over a few runs, after a warm-up
+template<typename F> double	time(const char *name, F &&f, int iterations = 1000000) {
+	run(f, iterations / 10);
+	double	ns = 1e30;
+	for (int i = 0; i < 5; i++)
+		ns = std::min(ns, run(f, iterations / 5));
+	printf("%-24s %8.1fns\n", name, ns);
+	return ns;
+}
+
+// the difference of two separate timings is mostly noise at this scale, so report the median and spread of many back to back pairs
+template<typename F, typename G> void	overhead(const char *name, F &&f, G &&baseline, int pairs = 21, int iterations = 200000) {
+	std::vector<double>	d;
+	for (int i = 0; i < pairs; i++)
+		d.push_back(run(f, iterations) - run(baseline, iterations));
+	std::sort(d.begin(), d.end());
+	printf("%-24s %8.1fns median, %.1f to %.1fns over %d pairs\n", name, d[pairs / 2], d.front(), d.back(), pairs);
+}
+
+int main() {
+	object	exports(napi_mock::load(Init));
+
+	auto	add		= function::is(value(exports["Add"]));
+	auto	raw_add	= function::is(value(exports["RawAdd"]));
+	auto	scale	= function::is(value(exports["Scale"]));
+	auto	greet	= function::is(value(exports["Greet"]));
+	auto	sum		= function::is(value(exports["Sum"]));
+	auto	point	= function::is(value(exports["Point"]));
+
+	array	a(1000);
+	for (int i = 0; i < 1000; i++)
+		a[i] = number(i);
+
+	auto	call_raw = [&](int i) { raw_add(i, 1); };
+	auto	call_lib = [&](int i) { add(i, 1); };
+	time("raw napi add",				call_raw);
+	time("add",							call_lib);
+	time("scale",						[&](int i) { scale(i * 0.5); });
+	time("greet",						[&](int) { greet("world"); });
+	time("sum of 1000",					[&](int) { sum(a); }, 10000);
+	time("new Point",					[&](int i) { napi_value args[] = {number(i), number(1)}; global_env.api<napi_new_instance>()(point, 2, args); }, 100000);
+	time("int round trip",				[&](int i) { from_value<int>(to_value(i)); });
+	time("string round trip",			[&](int) { from_value<std::string>(to_value("a short string")); });
+	overhead("library overhead per call", call_lib, call_raw);
+
+	napi_mock::reset();
+	printf("values still live: %zu (the class constructor with its prototype and methods, held by its static reference)\n", napi_mock::live_values());
+	return 0;
+}
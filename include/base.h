@@ -1,7 +1,10 @@
 #pragma once
 #include <type_traits>
 #include <initializer_list>
+#include <utility>
+#include <cstdint>
 #include <malloc.h>
+#include <string.h>
 
 //-----------------------------------------------------------------------------
 //	bare minimum
@@ -46,6 +49,9 @@ template<typename C, typename T> struct T_deref<T C::*>			: T_type<T> {};
 template<typename C, typename T> struct T_deref<const T C::*>	: T_type<const T> {};
 template<typename T> using deref_t = type_t<T_deref<T>>;
 
+template<typename T> struct T_member_class;
+template<typename C, typename T> struct T_member_class<T C::*> : T_type<C> {};
+
 template<typename T> struct remove_const : T_type<T> {};
 template<typename T> struct remove_const<const T>  : T_type<T> {};
 template<typename T> using remove_const_t			= type_t<remove_const<T>>;
@@ -60,6 +66,11 @@ template<typename T0, typename ...T> struct T_head<T0, T...> : T_type<T0> { usin
 template<typename...T> using head_t = type_t<T_head<T...>>;
 template<typename...T> using tail_t = typename T_head<T...>::tail;
 
+template<size_t I, typename...T> struct T_nth;
+template<typename T0, typename...T> struct T_nth<0, T0, T...> : T_type<T0> {};
+template<size_t I, typename T0, typename...T> struct T_nth<I, T0, T...> : T_nth<I - 1, T...> {};
+template<size_t I, typename...T> using nth_t = type_t<T_nth<I, T...>>;
+
 template<typename L, typename...R> struct T_except_last;
 template<typename...L, typename...R> struct T_except_last<typelist<L...>, typelist<R...>>			: T_except_last<typelist<L...>, R...> {};
 template<typename...L, typename M, typename...R>	struct T_except_last<typelist<L...>, M, R...>	: T_except_last<typelist<L..., M>, R...> {};
@@ -115,6 +126,72 @@ template<int N, bool S> using int_t = if_t<S,
 
 typedef unsigned char byte;
 
+//-----------------------------------------------------------------------------
+//	endian
+//-----------------------------------------------------------------------------
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+constexpr bool host_big_endian = true;
+#else
+constexpr bool host_big_endian = false;
+#endif
+
+inline uint8_t	byteswap(uint8_t x)		{ return x; }
+#if defined(_MSC_VER) && !defined(__clang__)
+inline uint16_t	byteswap(uint16_t x)	{ return _byteswap_ushort(x); }
+inline uint32_t	byteswap(uint32_t x)	{ return _byteswap_ulong(x); }
+inline uint64_t	byteswap(uint64_t x)	{ return _byteswap_uint64(x); }
+#else
+inline uint16_t	byteswap(uint16_t x)	{ return __builtin_bswap16(x); }
+inline uint32_t	byteswap(uint32_t x)	{ return __builtin_bswap32(x); }
+inline uint64_t	byteswap(uint64_t x)	{ return __builtin_bswap64(x); }
+#endif
+template<typename T> inline T byteswap(T x) {
+	int_t<sizeof(T) * 8, false>	u;
+	memcpy(&u, &x, sizeof(T));
+	u = byteswap(u);
+	memcpy(&x, &u, sizeof(T));
+	return x;
+}
+
+template<typename T> inline T		load_unaligned(const void *p)		{ T t; memcpy(&t, p, sizeof(T)); return t; }
+template<typename T> inline void	store_unaligned(void *p, T t)		{ memcpy(p, &t, sizeof(T)); }
+template<typename T> inline T		load_endian(const void *p, bool big)		{ auto t = load_unaligned<T>(p); return big != host_big_endian ? byteswap(t) : t; }
+template<typename T> inline void	store_endian(void *p, T t, bool big)		{ store_unaligned(p, big != host_big_endian ? byteswap(t) : t); }
+template<typename T> inline T		load_le(const void *p)				{ return load_endian<T>(p, false); }
+template<typename T> inline T		load_be(const void *p)				{ return load_endian<T>(p, true); }
+template<typename T> inline void	store_le(void *p, T t)				{ store_endian(p, t, false); }
+template<typename T> inline void	store_be(void *p, T t)				{ store_endian(p, t, true); }
+
+// bulk kernels: plain loops over fixed sizes so the compiler can vectorise the swaps
+template<typename T> void byteswap_n(T *p, size_t n) {
+	for (size_t i = 0; i < n; i++)
+		p[i] = byteswap(p[i]);
+}
+// n elements from s (stride bytes apart) into contiguous d
+template<typename T, bool BIG> void load_strided(T *d, const byte *s, size_t stride, size_t n) {
+	for (size_t i = 0; i < n; i++, s += stride)
+		d[i] = load_endian<T>(s, BIG);
+}
+// n contiguous elements from s into d (stride bytes apart)
+template<typename T, bool BIG> void store_strided(byte *d, const T *s, size_t stride, size_t n) {
+	for (size_t i = 0; i < n; i++, d += stride)
+		store_endian<T>(d, s[i], BIG);
+}
+
+// fixed byte order storage, usable as a struct member over wire data
+template<typename T, bool BIG> struct endian_t {
+	typedef T type;
+	static constexpr bool big = BIG;
+	byte	raw[sizeof(T)];
+	endian_t() {}
+	endian_t(T t)					{ store_endian(raw, t, BIG); }
+	endian_t& operator=(T t)		{ store_endian(raw, t, BIG); return *this; }
+	operator T()			const	{ return load_endian<T>(raw, BIG); }
+};
+template<typename T> using little_endian	= endian_t<T, false>;
+template<typename T> using big_endian		= endian_t<T, true>;
+
 //-----------------------------------------------------------------------------
 //	range
 //-----------------------------------------------------------------------------
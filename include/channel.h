@@ -0,0 +1,247 @@
+#pragma once
+#include "node.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+
+namespace Node {
+
+//-----------------------------------------------------------------------------
+//	channel - a bounded queue from one native producer thread to a JS async iterator
+//	the ring is lock-free; the producer only sleeps when it is full, and JS is only woken (through a threadsafe function) when it is waiting
+//	each next() resolves to a batch of up to batch items, so the per-item cost of crossing into JS is amortised
+//	return() (or the iterator being collected) cancels the channel: queued items are dropped and push() starts returning false
+//-----------------------------------------------------------------------------
+
+template<typename T> class channel {
+	std::vector<T>				slots;
+	size_t						mask;
+	uint32_t					batch;
+	std::atomic<size_t>			head{0}, tail{0};		// head is written by the producer, tail by the consumer
+	std::atomic<bool>			closed{false}, cancelled{false}, consumer_waiting{false}, producer_waiting{false};
+	std::atomic<int>			refs{2};				// the producer and the JS iterator
+	std::mutex					mutex;
+	std::condition_variable		space;
+	std::string					failure;				// written by the producer before closed is set
+
+	// main thread only
+	napi_threadsafe_function	tsfn	= nullptr;
+	bool						tsfn_live = true, tsfn_held = false;
+	std::deque<napi_deferred>	pending;
+
+	static size_t	ring_size(size_t capacity) { size_t n = 1; while (n < capacity) n <<= 1; return n; }
+
+	channel(size_t capacity, uint32_t batch) : slots(ring_size(max(capacity, size_t(1)))), mask(slots.size() - 1), batch(max(batch, 1u)) {}
+
+	void	release()	{ if (--refs == 0) delete this; }
+
+	void	hold(bool held) {
+		if (tsfn_live && held != tsfn_held) {
+			tsfn_held = held;
+			if (held)
+				napi_ref_threadsafe_function(global_env, tsfn);
+			else
+				napi_unref_threadsafe_function(global_env, tsfn);
+		}
+	}
+
+	void	wake_producer() {
+		if (producer_waiting) {
+			std::lock_guard<std::mutex>	lock(mutex);
+			space.notify_one();
+		}
+	}
+
+	static object	result(napi_value v, bool done) {
+		object	r;
+		r["value"]	= value(v);
+		r["done"]	= boolean(done);
+		return r;
+	}
+
+	// settles as many pending next() calls as the queue allows
+	void	drain() {
+		while (!pending.empty()) {
+			size_t	t = tail.load(std::memory_order_relaxed), h = head.load(std::memory_order_acquire);
+			if (t == h) {
+				if (closed && head.load() == t) {
+					auto	d = pending.front();
+					pending.pop_front();
+					if (!failure.empty()) {
+						napi_reject_deferred(global_env, d, error(string("ERR_CHANNEL"), string(failure.c_str())));
+						failure.clear();
+					} else {
+						napi_resolve_deferred(global_env, d, result(undefined, true));
+					}
+					continue;
+				}
+				// recheck after announcing, so a push racing with this cannot go unnoticed
+				consumer_waiting = true;
+				if (head.load() == t && !closed) {
+					hold(true);
+					return;
+				}
+				consumer_waiting = false;
+				continue;
+			}
+
+			size_t	n = min(h - t, size_t(batch));
+			array	a(n);
+			for (size_t i = 0; i < n; i++) {
+				auto	&s = slots[(t + i) & mask];
+				a[i] = to_value(std::move(s));
+				s = T();
+			}
+			tail.store(t + n);
+			wake_producer();
+
+			auto	d = pending.front();
+			pending.pop_front();
+			napi_resolve_deferred(global_env, d, result(a, false));
+		}
+		hold(false);
+	}
+
+	void	cancel() {
+		cancelled = true;
+		for (size_t t = tail, h = head; t != h; ++t)
+			slots[t & mask] = T();
+		tail.store(head.load());
+		{
+			std::lock_guard<std::mutex>	lock(mutex);
+			space.notify_one();
+		}
+		for (auto d : pending)
+			napi_resolve_deferred(global_env, d, result(undefined, true));
+		pending.clear();
+		hold(false);
+	}
+
+	static channel*	self(napi_env env, napi_callback_info info, napi_value *this_arg = nullptr) {
+		void*	data;
+		napi_get_cb_info(env, info, nullptr, nullptr, this_arg, &data);
+		return (channel*)data;
+	}
+
+public:
+	// main thread; the producer must eventually call close() (or fail()), and must not touch the channel afterwards
+	static channel*	make(const char *name, size_t capacity, uint32_t batch) {
+		auto	c = new channel(capacity, batch);
+		napi_create_threadsafe_function(global_env, nullptr, nullptr, string(name), 0, 1,
+			c, [](napi_env env, void *data, void*) {
+				auto	c = (channel*)data;
+				c->tsfn_live = false;
+				c->release();
+			},
+			c, [](napi_env env, napi_value, void *context, void*) {
+				if (env) {
+					save	s(global_env.env, env);
+					((channel*)context)->drain();
+				}
+			},
+			&c->tsfn
+		);
+		napi_unref_threadsafe_function(global_env, c->tsfn);
+		return c;
+	}
+
+	// main thread, once; the JS side of the channel: {next, return, [Symbol.asyncIterator]}
+	object	iterator() {
+		object	it;
+		it["next"] = function("next", callback{[](napi_env env, napi_callback_info info) -> napi_value {
+			save	s(global_env.env, env);
+			auto	c = self(env, info);
+			Promise	p;
+			c->pending.push_back(p.deferred);
+			c->drain();
+			return p;
+		}, this});
+		it["return"] = function("return", callback{[](napi_env env, napi_callback_info info) -> napi_value {
+			save	s(global_env.env, env);
+			self(env, info)->cancel();
+			Promise	p;
+			p.resolve(result(undefined, true));
+			return p;
+		}, this});
+		it[value(object(value(global["Symbol"]))["asyncIterator"])] = function("[Symbol.asyncIterator]", callback{[](napi_env env, napi_callback_info info) -> napi_value {
+			napi_value	this_arg;
+			self(env, info, &this_arg);
+			return this_arg;
+		}, this});
+		napi_add_finalizer(global_env, it, this, [](napi_env env, void *data, void*) {
+			save	s(global_env.env, env);
+			auto	c = (channel*)data;
+			c->cancel();
+			c->release();
+		}, nullptr, nullptr);
+		return it;
+	}
+
+	// producer thread
+	bool	wanted()	const	{ return !cancelled; }
+
+	// false if the queue is full (or the consumer has gone)
+	bool	try_push(T &&x) {
+		size_t	h = head.load(std::memory_order_relaxed);
+		if (cancelled || h - tail.load(std::memory_order_acquire) > mask)
+			return false;
+		slots[h & mask] = std::move(x);
+		head.store(h + 1);
+		if (consumer_waiting && consumer_waiting.exchange(false))
+			napi_call_threadsafe_function(tsfn, nullptr, napi_tsfn_nonblocking);
+		return true;
+	}
+
+	// blocks while the queue is full; false once the consumer has gone, so the producer can stop
+	bool	push(T &&x) {
+		for (int spin = 0; !try_push(std::move(x)); spin++) {
+			if (cancelled)
+				return false;
+			if (spin < 64) {
+				std::this_thread::yield();
+				continue;
+			}
+			std::unique_lock<std::mutex>	lock(mutex);
+			producer_waiting = true;
+			if (head.load() - tail.load() > mask && !cancelled)
+				space.wait(lock);
+			producer_waiting = false;
+		}
+		return true;
+	}
+	bool	push(const T &x) { return push(T(x)); }
+
+	// ends the stream after the items already queued; the next next() after those rejects with the message
+	// this closes the channel, so it is ignored once the channel is closed
+	void	fail(std::string message) {
+		if (closed)
+			return;
+		failure = std::move(message);
+		close();
+	}
+
+	// releases the producer's hold on the threadsafe function, so only the first call does anything
+	void	close() {
+		if (closed.exchange(true))
+			return;
+		if (consumer_waiting.exchange(false))
+			napi_call_threadsafe_function(tsfn, nullptr, napi_tsfn_nonblocking);
+		napi_release_threadsafe_function(tsfn, napi_tsfn_release);
+	}
+};
+
+// runs producer(channel<T>&) on its own thread and returns the async iterator that consumes it
+// the channel is closed when producer returns, so producer must not close it; to end with an error it calls fail() (which closes) and returns
+template<typename T, typename P> object async_channel(const char *name, P &&producer, size_t capacity = 1024, uint32_t batch = 64) {
+	auto	c	= channel<T>::make(name, capacity, batch);
+	auto	it	= c->iterator();
+	std::thread([c, producer = std::forward<P>(producer)]() mutable {
+		producer(*c);
+		c->close();
+	}).detach();
+	return it;
+}
+
+} // namespace Node
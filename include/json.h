@@ -0,0 +1,605 @@
+#pragma once
+#include "node.h"
+#include "text.h"
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <tuple>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define JSON_SSE2
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//-----------------------------------------------------------------------------
+//	json
+//	structs are described once with a field list, shared by the writer and the reader:
+//
+//	struct Row { uint32_t id; double price; std::string name; std::vector<int> tags; };
+//	template<> constexpr auto Node::json_fields<Row> = std::make_tuple(field<&Row::id>("id"), field<&Row::price>("price"), field<&Row::name>("name"), field<&Row::tags>("tags"));
+//-----------------------------------------------------------------------------
+
+namespace Node {
+
+template<typename T> constexpr auto json_fields = nullptr;
+template<typename T> constexpr bool has_json_fields = !std::is_same_v<std::decay_t<decltype(json_fields<T>)>, std::nullptr_t>;
+
+template<typename T> struct is_json_array : std::false_type {};
+template<typename T> struct is_json_array<std::vector<T>> : std::true_type {};
+template<typename T> struct is_json_array<range<T*>> : std::true_type {};
+template<typename T> struct is_json_array<alloc_block<T>> : std::true_type {};
+
+namespace json {
+
+inline int lowest_bit(uint64_t x) {
+#ifdef _MSC_VER
+	unsigned long	i;
+	_BitScanForward64(&i, x);
+	return int(i);
+#else
+	return __builtin_ctzll(x);
+#endif
+}
+
+// index of the first byte that must be escaped in a string (a control character, quote or backslash), or n
+inline size_t find_escape(const char *p, size_t n) {
+	size_t	i = 0;
+#ifdef JSON_SSE2
+	const __m128i	quote	= _mm_set1_epi8('"');
+	const __m128i	slash	= _mm_set1_epi8('\\');
+	const __m128i	space	= _mm_set1_epi8(' ');
+	for (; i + 16 <= n; i += 16) {
+		__m128i	v		= _mm_loadu_si128((const __m128i*)(p + i));
+		// bytes >= 0x80 are negative as signed, so the control test also needs them excluded
+		__m128i	ctrl	= _mm_andnot_si128(_mm_cmplt_epi8(v, _mm_setzero_si128()), _mm_cmplt_epi8(v, space));
+		if (int mask = _mm_movemask_epi8(_mm_or_si128(ctrl, _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, slash)))))
+			return i + lowest_bit(mask);
+	}
+#endif
+	for (; i < n; i++) {
+		uint8_t	c = p[i];
+		if (c < ' ' || c == '"' || c == '\\')
+			return i;
+	}
+	return n;
+}
+
+} // namespace json
+
+//-----------------------------------------------------------------------------
+//	JSONWriter - streams JSON text to a TextWriter
+//	values written directly (begin_object/key/value/end_object) or reflected from json_fields
+//-----------------------------------------------------------------------------
+
+class JSONWriter {
+	TextWriter<char>	&w;
+	bool				comma = false;		// a value has been written at the current level
+	size_t				used = 0;
+	char				buffer[8192];		// tokens are batched so the TextWriter sees a few large writes
+
+	void	sep()							{ if (exchange(comma, true)) raw(",", 1); }
+	void	raw(const char *s, size_t n) {
+		if (used + n > sizeof(buffer)) {
+			flush();
+			if (n > sizeof(buffer) / 2) {
+				w.write(s, n);
+				return;
+			}
+		}
+		memcpy(buffer + used, s, n);
+		used += n;
+	}
+
+	template<typename T, size_t...I> void	fields(const T &t, std::index_sequence<I...>) {
+		(field(std::get<I>(json_fields<T>).name, t.*member(std::get<I>(json_fields<T>))), ...);
+	}
+	template<auto F, typename X> static constexpr auto	member(const ::field<F, X>&)	{ return F; }
+
+public:
+	JSONWriter(TextWriter<char> &w) : w(w) {}
+	~JSONWriter()	{ flush(); }
+	void	flush()	{ if (used) w.write(buffer, exchange(used, 0)); }
+
+	JSONWriter&	begin_object()		{ sep(); raw("{", 1); comma = false; return *this; }
+	JSONWriter&	end_object()		{ raw("}", 1); comma = true; return *this; }
+	JSONWriter&	begin_array()		{ sep(); raw("[", 1); comma = false; return *this; }
+	JSONWriter&	end_array()			{ raw("]", 1); comma = true; return *this; }
+
+	JSONWriter&	key(const char *k, size_t n)	{ sep(); string(k, n); raw(":", 1); comma = false; return *this; }
+	JSONWriter&	key(const char *k)				{ return key(k, strlen(k)); }
+	template<typename T> JSONWriter& field(const char *k, const T &t)	{ return key(k).value(t); }
+
+	JSONWriter&	null()				{ sep(); raw("null", 4); return *this; }
+
+	// runs of plain characters are written whole; only the escaped characters go one at a time
+	JSONWriter&	string(const char *s, size_t n) {
+		static const char	hex[] = "0123456789abcdef";
+		raw("\"", 1);
+		while (n) {
+			auto	i = json::find_escape(s, n);
+			if (i)
+				raw(s, i);
+			if (i == n)
+				break;
+			char	e[6] = {'\\', 0};
+			size_t	en	= 2;
+			switch (uint8_t c = s[i]) {
+				case '"':	e[1] = '"'; break;
+				case '\\':	e[1] = '\\'; break;
+				case '\b':	e[1] = 'b'; break;
+				case '\f':	e[1] = 'f'; break;
+				case '\n':	e[1] = 'n'; break;
+				case '\r':	e[1] = 'r'; break;
+				case '\t':	e[1] = 't'; break;
+				default:
+					e[1] = 'u'; e[2] = '0'; e[3] = '0'; e[4] = hex[c >> 4]; e[5] = hex[c & 15];
+					en = 6;
+					break;
+			}
+			raw(e, en);
+			s += i + 1;
+			n -= i + 1;
+		}
+		raw("\"", 1);
+		return *this;
+	}
+
+	template<typename T> JSONWriter& value(const T &t) {
+		if constexpr (std::is_same_v<T, bool>) {
+			sep();
+			t ? raw("true", 4) : raw("false", 5);
+		} else if constexpr (std::is_same_v<T, std::nullptr_t>) {
+			null();
+		} else if constexpr (std::is_integral_v<T>) {
+			char	temp[24], *d = end(temp);
+			if constexpr (std::is_signed_v<T>) {
+				d = put_decimal(t < 0 ? 0 - uint64_t(t) : uint64_t(t), d);
+				if (t < 0)
+					*--d = '-';
+			} else {
+				d = put_decimal(t, d);
+			}
+			sep();
+			raw(d, end(temp) - d);
+		} else if constexpr (std::is_floating_point_v<T>) {
+			// shortest text that round trips; JSON has no NaN or infinity
+			if (!std::isfinite(t))
+				return null();
+			if (std::abs(t) < T(1ull << std::numeric_limits<T>::digits) && t == T(int64_t(t)) && !(t == 0 && std::signbit(t)))
+				return value(int64_t(t));
+			char	temp[32];
+			auto	e = put_float(t, temp, end(temp));
+			sep();
+			raw(temp, e - temp);
+		} else if constexpr (std::is_convertible_v<const T&, const char*>) {
+			sep();
+			const char *s = t;
+			string(s, strlen(s));
+		} else if constexpr (std::is_same_v<T, std::string>) {
+			sep();
+			string(t.data(), t.size());
+		} else if constexpr (is_json_array<T>::value) {
+			begin_array();
+			for (auto &i : t)
+				value(i);
+			end_array();
+		} else if constexpr (has_json_fields<T>) {
+			begin_object();
+			fields(t, std::make_index_sequence<std::tuple_size_v<std::decay_t<decltype(json_fields<T>)>>>());
+			end_object();
+		} else {
+			// anything else writes itself: t(JSONWriter&)
+			t(*this);
+		}
+		return *this;
+	}
+	template<typename T> JSONWriter& operator<<(const T &t) { return value(t); }
+};
+
+//-----------------------------------------------------------------------------
+//	structural index - stage 1 of the reader
+//	one pass over 64 byte blocks builds bitmasks of quotes, backslashes, operators and whitespace,
+//	works out which bytes are inside strings with a prefix xor, and records the offsets of every
+//	operator, opening quote and scalar outside strings; stage 2 then hops between those offsets
+//-----------------------------------------------------------------------------
+
+namespace json {
+
+struct block_masks {
+	uint64_t	quote, backslash, op, space;
+};
+
+inline block_masks classify(const char *p) {
+	block_masks	m;
+#ifdef JSON_SSE2
+	__m128i	v[4];
+	for (int i = 0; i < 4; i++)
+		v[i] = _mm_loadu_si128((const __m128i*)(p + i * 16));
+	auto	bits = [&v](auto test) {
+		uint64_t	r = 0;
+		for (int i = 0; i < 4; i++)
+			r |= uint64_t(uint16_t(_mm_movemask_epi8(test(v[i])))) << (i * 16);
+		return r;
+	};
+	auto	eq = [](char c) { return [c](__m128i x) { return _mm_cmpeq_epi8(x, _mm_set1_epi8(c)); }; };
+	m.quote		= bits(eq('"'));
+	m.backslash	= bits(eq('\\'));
+	m.op		= bits([](__m128i x) {
+		return _mm_or_si128(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('{')), _mm_cmpeq_epi8(x, _mm_set1_epi8('}'))),
+			_mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('[')), _mm_cmpeq_epi8(x, _mm_set1_epi8(']')))),
+			_mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(':')), _mm_cmpeq_epi8(x, _mm_set1_epi8(','))));
+	});
+	m.space		= bits([](__m128i x) {
+		return _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\t'))),
+			_mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\r'))));
+	});
+#else
+	m = {};
+	for (int i = 0; i < 64; i++) {
+		uint64_t	bit = uint64_t(1) << i;
+		switch (p[i]) {
+			case '"':	m.quote |= bit; break;
+			case '\\':	m.backslash |= bit; break;
+			case '{': case '}': case '[': case ']': case ':': case ',':	m.op |= bit; break;
+			case ' ': case '\t': case '\n': case '\r':	m.space |= bit; break;
+		}
+	}
+#endif
+	return m;
+}
+
+inline uint64_t prefix_xor(uint64_t x) {
+	x ^= x << 1;
+	x ^= x << 2;
+	x ^= x << 4;
+	x ^= x << 8;
+	x ^= x << 16;
+	x ^= x << 32;
+	return x;
+}
+
+// offsets of structural characters; returns false if a string is left open
+inline bool structural_index(range<const char*> text, growing_block<uint32_t> &index) {
+	auto		p			= text.begin();
+	size_t		n			= text.size();
+	uint64_t	in_string	= 0;		// all ones if the previous block ended inside a string
+	uint64_t	escaped		= 0;		// bit 0 set if the previous block ended with an unescaped backslash
+	uint64_t	scalar		= 0;		// bit 0 set if the previous block ended inside a scalar
+
+	index = growing_block<uint32_t>(n / 4 + 64);
+
+	for (size_t i = 0; i < n; i += 64) {
+		block_masks	m;
+		if (i + 64 <= n) {
+			m = classify(p + i);
+		} else {
+			char	tail[64];
+			memset(tail, ' ', 64);
+			memcpy(tail, p + i, n - i);
+			m = classify(tail);
+		}
+
+		// a backslash escapes the next byte unless it is itself escaped: find the odd length runs with a carrying add
+		uint64_t	esc = escaped;
+		if (m.backslash) {
+			const uint64_t	even		= 0x5555555555555555ull;
+			uint64_t	bs				= m.backslash & ~escaped;
+			uint64_t	follows			= bs << 1 | escaped;
+			uint64_t	odd_starts		= bs & ~even & ~follows;
+			uint64_t	even_sequences	= odd_starts + bs;
+			escaped		= even_sequences < bs;
+			esc			= ((even ^ (even_sequences << 1)) & follows);
+		} else {
+			escaped		= 0;
+		}
+
+		uint64_t	quotes	= m.quote & ~esc;
+		uint64_t	inside	= prefix_xor(quotes) ^ in_string;
+		in_string	= uint64_t(int64_t(inside) >> 63);
+
+		uint64_t	ops		= m.op & ~inside;
+		uint64_t	opening	= quotes & inside;
+		uint64_t	atoms	= ~(m.op | m.space | m.quote | inside);
+		uint64_t	starts	= atoms & ~((atoms << 1) | scalar);
+		scalar		= atoms >> 63;
+
+		auto	d = index.ensure(64);
+		for (uint64_t bits = ops | opening | starts; bits; bits &= bits - 1)
+			*d++ = uint32_t(i + lowest_bit(bits));
+		index.p = d;
+	}
+	return !in_string;
+}
+
+} // namespace json
+
+//-----------------------------------------------------------------------------
+//	JSONReader - stage 2: fills native values straight from the text
+//	only what the target asks for is decoded; unknown keys are skipped by hopping over the index
+//-----------------------------------------------------------------------------
+
+class JSONReader {
+	TextReader<char>		r;
+	const char				*base;
+	growing_block<uint32_t>	index;
+	const uint32_t			*i, *e;
+
+	char	peek()		const	{ return i < e ? base[*i] : 0; }
+	char	next()				{ return i < e ? base[*i++] : 0; }
+	// positions the TextReader at the current token
+	TextReader<char>&	at()	{ r.p = base + *i++; return r; }
+
+	template<auto F, typename X> static constexpr auto	member(const ::field<F, X>&)	{ return F; }
+
+	template<typename T, size_t...I> bool	fields(T &t, range<const char*> key, std::index_sequence<I...>) {
+		bool	ok		= true;
+		bool	found	= ((match(std::get<I>(json_fields<T>).name, key) && (ok = read(t.*member(std::get<I>(json_fields<T>))), true)) || ...);
+		return found ? ok : skip();
+	}
+	static bool	match(const char *name, range<const char*> key) {
+		return strlen(name) == key.size() && memcmp(name, key.begin(), key.size()) == 0;
+	}
+	// a scalar must run up to whitespace or the next token, so 12abc or trueX are not read as a prefix
+	bool	ended(const char *p) const {
+		return p == (i < e ? base + *i : r.end) || (p < r.end && is_whitespace(*p));
+	}
+
+	// the raw text of a string token without its quotes; false if it contains escapes
+	bool	raw_string(range<const char*> &s) {
+		auto	p = base + *i++ + 1;
+		auto	q = p;
+		while (q < r.end && *q != '"' && *q != '\\')
+			++q;
+		s = {p, q};
+		return q < r.end && *q == '"';
+	}
+
+	static void	put_utf8(std::string &s, uint32_t c) {
+		if (c < 0x80) {
+			s += char(c);
+		} else if (c < 0x800) {
+			s += char(0xc0 | (c >> 6));
+			s += char(0x80 | (c & 0x3f));
+		} else if (c < 0x10000) {
+			s += char(0xe0 | (c >> 12));
+			s += char(0x80 | ((c >> 6) & 0x3f));
+			s += char(0x80 | (c & 0x3f));
+		} else {
+			s += char(0xf0 | (c >> 18));
+			s += char(0x80 | ((c >> 12) & 0x3f));
+			s += char(0x80 | ((c >> 6) & 0x3f));
+			s += char(0x80 | (c & 0x3f));
+		}
+	}
+	bool	hex4(const char *p, uint32_t &c) {
+		if (r.end - p < 4)
+			return false;
+		c = 0;
+		for (int j = 0; j < 4; j++) {
+			char	h = p[j];
+			if (!is_digit(h) && !between(to_lower(h), 'a', 'f'))
+				return false;
+			c = c * 16 + from_digit(h);
+		}
+		return true;
+	}
+
+	template<typename T> bool	integer(T &t) {
+		auto&	rd	= at();
+		bool	neg	= rd.skip('-');
+		if (neg && !std::is_signed_v<T>)
+			return false;
+		if (!is_digit(rd.peek()))
+			return false;
+		uint64_t	u = 0;
+		while (is_digit(rd.peek())) {
+			uint64_t	d = rd.read() - '0';
+			if (u > (~uint64_t(0) - d) / 10)
+				return false;
+			u = u * 10 + d;
+		}
+		if (!ended(rd.p))
+			return false;
+		if constexpr (std::is_signed_v<T>) {
+			if (u > uint64_t(std::numeric_limits<T>::max()) + neg)
+				return false;
+			t = neg ? T(0 - u) : T(u);
+		} else {
+			if (u > std::numeric_limits<T>::max())
+				return false;
+			t = T(u);
+		}
+		return true;
+	}
+
+public:
+	// the text must outlive the reader; strings are copied out as they are read
+	JSONReader(range<const char*> text) : r(text.begin(), text.size()), base(text.begin()) {
+		if (text.size() < 0xffffffffu && json::structural_index(text, index)) {
+			i = index.begin();
+			e = index.p;
+		} else {
+			i = e = nullptr;
+		}
+	}
+
+	explicit operator bool()	const	{ return !!i; }
+	bool	done()				const	{ return i == e; }
+
+	// skips one value of any kind
+	bool	skip() {
+		char	c = next();
+		if (c == '{' || c == '[') {
+			for (int depth = 1; depth;) {
+				switch (next()) {
+					case '{': case '[':	++depth; break;
+					case '}': case ']':	--depth; break;
+					case 0:				return false;
+				}
+			}
+			return true;
+		}
+		return c && c != '}' && c != ']' && c != ':' && c != ',';
+	}
+
+	bool	read(std::string &s) {
+		if (peek() != '"')
+			return false;
+		auto	p = base + *i++ + 1;
+		s.clear();
+		for (;;) {
+			auto	n	= json::find_escape(p, r.end - p);
+			s.append(p, n);
+			p += n;
+			if (p == r.end || *p != '\\')
+				return p < r.end && *p == '"';
+			if (r.end - p < 2)
+				return false;
+			switch (p[1]) {
+				case '"': case '\\': case '/':	s += p[1]; break;
+				case 'b':	s += '\b'; break;
+				case 'f':	s += '\f'; break;
+				case 'n':	s += '\n'; break;
+				case 'r':	s += '\r'; break;
+				case 't':	s += '\t'; break;
+				case 'u': {
+					uint32_t	c;
+					if (!hex4(p + 2, c))
+						return false;
+					p += 4;
+					// surrogate pairs arrive as two escapes
+					uint32_t	lo;
+					if (between(c, 0xd800, 0xdbff) && p + 2 < r.end && p[2] == '\\' && p[3] == 'u' && hex4(p + 4, lo) && between(lo, 0xdc00, 0xdfff)) {
+						c = 0x10000 + ((c - 0xd800) << 10) + (lo - 0xdc00);
+						p += 6;
+					}
+					put_utf8(s, c);
+					break;
+				}
+				default:
+					return false;
+			}
+			p += 2;
+		}
+	}
+
+	bool	read(bool &t) {
+		auto&	rd = at();
+		bool	v = rd.skip("true");
+		if (!v && !rd.skip("false"))
+			return false;
+		t = v;
+		return ended(rd.p);
+	}
+
+	template<typename T> bool	read(T &t) {
+		if (peek() == 'n') {
+			// null leaves the target as it was
+			auto&	rd = at();
+			return rd.skip("null") && ended(rd.p);
+		}
+		if constexpr (std::is_integral_v<T>) {
+			return integer(t);
+		} else if constexpr (std::is_floating_point_v<T>) {
+			// from_chars also takes inf and nan, which JSON does not
+			auto&	rd = at();
+			auto	c = rd.p[rd.p[0] == '-' && rd.available() > 1];
+			return is_digit(c) && get_float(rd, t) && ended(rd.p);
+		} else if constexpr (is_json_array<T>::value) {
+			if (next() != '[')
+				return false;
+			t.clear();
+			if (peek() == ']')
+				return next(), true;
+			do {
+				t.emplace_back();
+				if (!read(t.back()))
+					return false;
+			} while (peek() == ',' && next());
+			return next() == ']';
+		} else {
+			static_assert(has_json_fields<T>, "no json_fields for this type");
+			if (next() != '{')
+				return false;
+			if (peek() == '}')
+				return next(), true;
+			do {
+				range<const char*>	key;
+				std::string			decoded;
+				if (peek() != '"')
+					return false;
+				// keys with escapes are rare, so only they pay for a decoded copy
+				auto	at_key = i;
+				if (!raw_string(key)) {
+					i = at_key;
+					if (!read(decoded))
+						return false;
+					key = {decoded.data(), decoded.data() + decoded.size()};
+				}
+				if (next() != ':')
+					return false;
+				if (!fields(t, key, std::make_index_sequence<std::tuple_size_v<std::decay_t<decltype(json_fields<T>)>>>()))
+					return false;
+			} while (peek() == ',' && next());
+			return next() == '}';
+		}
+	}
+};
+
+// false if the text is not valid JSON for T; fields missing from the text keep their values
+template<typename T> bool parse_json(range<const char*> text, T &t) {
+	JSONReader	r(text);
+	return r && r.read(t) && r.done();
+}
+
+//-----------------------------------------------------------------------------
+//	to JS - the text goes straight into a Buffer or string, without building JS objects first
+//-----------------------------------------------------------------------------
+
+template<typename T> Buffer to_json_buffer(const T &t) {
+	BlockWriter<char>	w(64 * 1024);
+	JSONWriter(w).value(t).flush();
+	auto	n		= w.size();
+	auto	data	= w.block.detach();
+#ifndef NODE_API_NO_EXTERNAL_BUFFERS_ALLOWED
+	napi_value	v;
+	if (n && napi_create_external_buffer(global_env, n, data, [](node_api_nogc_env, void *data, void*) { free(data); }, nullptr, &v) == napi_ok)
+		return Buffer(v);
+#endif
+	auto	b	= Buffer::copy({(const byte*)data, n});
+	free(data);
+	return b;
+}
+
+template<typename T> string to_json_string(const T &t) {
+	BlockWriter<char>	w(64 * 1024);
+	JSONWriter(w).value(t).flush();
+	auto	n		= w.size();
+#if NAPI_VERSION >= 10
+	// pure ascii text can be handed over as an external latin1 string instead of copied
+	if (n >= node_type<std::string>::external_threshold && node_type<std::string>::is_ascii(w.block.begin(), n)) {
+		auto	data	= w.block.detach();
+		if (auto s = string::make_external(data, n, finalizer([](node_api_nogc_env, void *data, void*) { free(data); }, nullptr)))
+			return s;
+		string	s(data, n);
+		free(data);
+		return s;
+	}
+#endif
+	return string(w.block.begin(), n);
+}
+
+// v is a Buffer, TypedArray, ArrayBuffer or DataView (read in place) or a string (copied out as utf8)
+template<typename T> bool from_json(napi_value v, T &t) {
+	if (global_env.type(v) == napi_string) {
+		auto	text = from_value<std::string>(v);
+		return parse_json(range<const char*>(text.data(), text.size()), t);
+	}
+	auto	data = binary_data(v);
+	return parse_json(range<const char*>((const char*)data.begin(), data.size()), t);
+}
+
+}	// namespace Node
@@ -0,0 +1,90 @@
+#pragma once
+#include "node.h"
+#include "simd.h"
+
+//-----------------------------------------------------------------------------
+//	bindable wrappers around simd.h
+//	eg. {"sum", Node::function::make<Node::kernels::sum<double>>()}
+//	arguments of the wrong TypedArray type are treated as empty
+//-----------------------------------------------------------------------------
+
+namespace Node { namespace kernels {
+
+template<typename T> range<const T*> input(TypedArray<T> a) { return TypedArray<T>::is(a).native(); }
+
+template<typename T> double	sum(TypedArray<T> a)					{ return double(simd::sum(input(a))); }
+template<typename T> double	dot(TypedArray<T> a, TypedArray<T> b)	{ return double(simd::dot(input(a), input(b))); }
+template<typename T> double	min(TypedArray<T> a)					{ return double(simd::min(input(a))); }
+template<typename T> double	max(TypedArray<T> a)					{ return double(simd::max(input(a))); }
+
+template<typename OP, typename T> TypedArray<T> binary(TypedArray<T> a, TypedArray<T> b) {
+	auto	ra = input(a), rb = input(b);
+	T*		d;
+	auto	n	= ::min(ra.size(), rb.size());
+	TypedArray<T>	r(n, &d);
+	simd::binary<OP>(ra, rb, range<T*>(d, n));
+	return r;
+}
+template<typename OP, typename T> TypedArray<T> binary_scalar(TypedArray<T> a, double b) {
+	auto	ra = input(a);
+	T*		d;
+	TypedArray<T>	r(ra.size(), &d);
+	simd::binary<OP>(ra, T(b), range<T*>(d, ra.size()));
+	return r;
+}
+
+template<typename T> TypedArray<T>	add(TypedArray<T> a, TypedArray<T> b)	{ return binary<simd::op_add>(a, b); }
+template<typename T> TypedArray<T>	sub(TypedArray<T> a, TypedArray<T> b)	{ return binary<simd::op_sub>(a, b); }
+template<typename T> TypedArray<T>	mul(TypedArray<T> a, TypedArray<T> b)	{ return binary<simd::op_mul>(a, b); }
+template<typename T> TypedArray<T>	div(TypedArray<T> a, TypedArray<T> b)	{ static_assert(std::is_floating_point<T>::value, "integer division is not vectorised"); return binary<simd::op_div>(a, b); }
+template<typename T> TypedArray<T>	minimum(TypedArray<T> a, TypedArray<T> b)	{ return binary<simd::op_min>(a, b); }
+template<typename T> TypedArray<T>	maximum(TypedArray<T> a, TypedArray<T> b)	{ return binary<simd::op_max>(a, b); }
+template<typename T> TypedArray<T>	offset(TypedArray<T> a, double b)		{ return binary_scalar<simd::op_add>(a, b); }
+template<typename T> TypedArray<T>	scale(TypedArray<T> a, double b)		{ return binary_scalar<simd::op_mul>(a, b); }
+
+// float64 <-> float32, int <-> float (static_cast semantics)
+template<typename S, typename D> TypedArray<D> convert(TypedArray<S> a) {
+	auto	ra = input(a);
+	D*		d;
+	TypedArray<D>	r(ra.size(), &d);
+	simd::convert(ra, range<D*>(d, ra.size()));
+	return r;
+}
+
+template<typename S> TypedArray<uint8_clamped> to_clamped(TypedArray<S> a) {
+	auto	ra = input(a);
+	uint8_clamped*	d;
+	TypedArray<uint8_clamped>	r(ra.size(), &d);
+	simd::to_clamped(ra, range<uint8_t*>((uint8_t*)d, ra.size()));
+	return r;
+}
+
+template<typename T> TypedArray<T> prefix_sum(TypedArray<T> a) {
+	auto	ra = input(a);
+	T*		d;
+	TypedArray<T>	r(ra.size(), &d);
+	simd::prefix_sum(ra, range<T*>(d, ra.size()));
+	return r;
+}
+
+// result[i] = src[index[i]]
+template<typename T> TypedArray<T> gather(TypedArray<T> src, TypedArray<uint32_t> index) {
+	auto	ri = input(index);
+	T*		d;
+	TypedArray<T>	r(ri.size(), &d);
+	simd::gather(input(src), ri, range<T*>(d, ri.size()));
+	return r;
+}
+
+// dst[index[i]] = src[i], in place
+template<typename T> void scatter(TypedArray<T> dst, TypedArray<uint32_t> index, TypedArray<T> src) {
+	simd::scatter(input(src), input(index), TypedArray<T>::is(dst).native());
+}
+
+// "scalar", "sse2", "avx2" or "avx512"
+inline const char*	isa() {
+	static const char *names[] = {"scalar", "sse2", "avx2", "avx512"};
+	return names[simd::get_isa()];
+}
+
+} } // namespace Node::kernels
@@ -0,0 +1,227 @@
+#pragma once
+#include "node.h"
+#include <atomic>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//-----------------------------------------------------------------------------
+//	memory mapped files
+//	the mapping is shared with the page cache (and every other process mapping the same file), so large tables cost no copies
+//-----------------------------------------------------------------------------
+
+enum class map_mode {
+	read,			// pages are mapped read only: for native use, as a write through a JS view would fault
+	copy_on_write,	// pages are private on first write; the file is never modified
+};
+
+enum map_advice : unsigned {
+	advise_normal		= 0,
+	advise_sequential	= 1 << 0,
+	advise_random		= 1 << 1,
+	advise_willneed		= 1 << 2,	// start readahead of the whole mapping
+	advise_hugepage		= 1 << 3,	// transparent huge pages where the kernel supports them for file mappings
+	advise_prefault		= 1 << 4,	// touch every page on a background thread
+};
+
+class mapped_file {
+	struct mapping {
+		std::atomic<int>	refs{1};
+		std::atomic<bool>	closing{false};
+		void*				base;		// page aligned start of the mapping
+		size_t				base_size;
+		byte*				data;
+		size_t				size;
+		bool				writable;
+
+		~mapping() {
+		#ifdef _WIN32
+			UnmapViewOfFile(base);
+		#else
+			munmap(base, base_size);
+		#endif
+		}
+		void	add_ref()	{ ++refs; }
+		void	release()	{ if (--refs == 0) delete this; }
+	};
+	mapping	*m = nullptr;
+
+	static size_t	granularity() {
+	#ifdef _WIN32
+		SYSTEM_INFO	info;
+		GetSystemInfo(&info);
+		return info.dwAllocationGranularity;
+	#else
+		return sysconf(_SC_PAGESIZE);
+	#endif
+	}
+
+public:
+	mapped_file()	{}
+	mapped_file(mapped_file &&b) : m(exchange(b.m, nullptr)) {}
+	~mapped_file()	{ close(); }
+	mapped_file& operator=(mapped_file &&b) { close(); m = exchange(b.m, nullptr); return *this; }
+
+	// length 0 maps to the end of the file
+	mapped_file(const char *path, map_mode mode = map_mode::read, uint64_t offset = 0, size_t length = 0) {
+		auto	align	= granularity();
+		auto	start	= offset - offset % align;
+	#ifdef _WIN32
+		wchar_t	wpath[MAX_PATH];
+		if (!MultiByteToWideChar(CP_UTF8, 0, path, -1, wpath, MAX_PATH))
+			return;
+		HANDLE	file = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return;
+		LARGE_INTEGER	file_size;
+		GetFileSizeEx(file, &file_size);
+		if (offset >= uint64_t(file_size.QuadPart) || !(length = length ? min(length, size_t(file_size.QuadPart - offset)) : size_t(file_size.QuadPart - offset))) {
+			CloseHandle(file);
+			return;
+		}
+		HANDLE	section = CreateFileMappingW(file, nullptr, mode == map_mode::read ? PAGE_READONLY : PAGE_WRITECOPY, 0, 0, nullptr);
+		CloseHandle(file);
+		if (!section)
+			return;
+		auto	base_size	= size_t(offset - start) + length;
+		void*	base		= MapViewOfFile(section, mode == map_mode::read ? FILE_MAP_READ : FILE_MAP_COPY, DWORD(start >> 32), DWORD(start), base_size);
+		CloseHandle(section);
+		if (!base)
+			return;
+	#else
+		int		fd = ::open(path, O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+			return;
+		struct stat	st;
+		if (fstat(fd, &st) != 0 || offset >= uint64_t(st.st_size) || !(length = length ? min(length, size_t(st.st_size - offset)) : size_t(st.st_size - offset))) {
+			::close(fd);
+			return;
+		}
+		auto	base_size	= size_t(offset - start) + length;
+		// a private writable mapping would otherwise reserve swap for every page up front, though only written pages are ever copied
+		void*	base		= mode == map_mode::read
+			? mmap(nullptr, base_size, PROT_READ, MAP_PRIVATE, fd, start)
+			: mmap(nullptr, base_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_NORESERVE, fd, start);
+		::close(fd);
+		if (base == MAP_FAILED)
+			return;
+	#endif
+		m				= new mapping;
+		m->base			= base;
+		m->base_size	= base_size;
+		m->data			= (byte*)base + (offset - start);
+		m->size			= length;
+		m->writable		= mode != map_mode::read;
+	}
+
+	explicit operator bool()	const	{ return !!m; }
+	byte*			data()		const	{ return m ? m->data : nullptr; }
+	size_t			size()		const	{ return m ? m->size : 0; }
+	range<byte*>	native()	const	{ return {data(), size()}; }
+
+	void	close() {
+		if (m) {
+			m->closing = true;
+			exchange(m, nullptr)->release();
+		}
+	}
+
+	bool	advise(unsigned advice) {
+		if (!m)
+			return false;
+		bool	ok = true;
+	#ifdef _WIN32
+		if (advice & advise_willneed) {
+			WIN32_MEMORY_RANGE_ENTRY	entry = {m->base, m->base_size};
+			ok = PrefetchVirtualMemory(GetCurrentProcess(), 1, &entry, 0);
+		}
+	#else
+		if (advice & advise_sequential)
+			ok &= madvise(m->base, m->base_size, MADV_SEQUENTIAL) == 0;
+		if (advice & advise_random)
+			ok &= madvise(m->base, m->base_size, MADV_RANDOM) == 0;
+		if (advice & advise_willneed)
+			ok &= madvise(m->base, m->base_size, MADV_WILLNEED) == 0;
+		#ifdef MADV_HUGEPAGE
+		if (advice & advise_hugepage)
+			ok &= madvise(m->base, m->base_size, MADV_HUGEPAGE) == 0;
+		#endif
+	#endif
+		if (advice & advise_prefault)
+			prefault();
+		return ok;
+	}
+
+	// reads one byte per page on a detached thread; stops early if the mapping is closed, and keeps it alive until it does
+	void	prefault() {
+		if (!m)
+			return;
+		m->add_ref();
+		std::thread([m = m, page = granularity()] {
+			volatile byte	sink = 0;
+			auto			p	= (const volatile byte*)m->base;
+			for (size_t i = 0; i < m->base_size && !m->closing; i += page)
+				sink = sink + p[i];
+			m->release();
+		}).detach();
+	}
+
+	//-----------------------------------------------------------------------------
+	//	JS views; the mapping is released by the ArrayBuffer's finalizer
+	//	ArrayBuffers are always writable and Node-API has no read only view, so a read only mapping is refused (an empty result) rather than left to fault on the first JS write
+	//-----------------------------------------------------------------------------
+
+#ifndef NODE_API_NO_EXTERNAL_BUFFERS_ALLOWED
+	Node::ArrayBuffer	array_buffer() {
+		if (!m || !m->writable)
+			return Node::ArrayBuffer(nullptr);
+		Node::ArrayBuffer	buffer(data(), size(), Node::finalizer([](node_api_nogc_env, void*, void *hint) {
+			auto	m = (mapping*)hint;
+			m->closing = true;
+			m->release();
+		}, m));
+		// the buffer only owns the mapping once it exists; otherwise it stays here and is unmapped with this object
+		if (buffer)
+			m = nullptr;
+		return buffer;
+	}
+	template<typename T> Node::TypedArray<T> typed_array() {
+		auto	n = size() / sizeof(T);
+		return Node::TypedArray<T>(array_buffer(), 0, n);
+	}
+	Node::DataView	data_view() {
+		auto	n = size();
+		return Node::DataView(array_buffer(), n, 0);
+	}
+#endif
+};
+
+#ifndef NODE_API_NO_EXTERNAL_BUFFERS_ALLOWED
+namespace Node {
+
+inline ArrayBuffer	map_file(const char *path, map_mode mode = map_mode::copy_on_write, unsigned advice = advise_normal, uint64_t offset = 0, size_t length = 0) {
+	mapped_file	f(path, mode, offset, length);
+	f.advise(advice);
+	return f.array_buffer();
+}
+inline ArrayBuffer	map_file(string path, map_mode mode = map_mode::copy_on_write, unsigned advice = advise_normal, uint64_t offset = 0, size_t length = 0) {
+	std::string	buffer(path.get_utf8(nullptr, 0), '\0');
+	path.get_utf8(buffer.data(), buffer.size() + 1);
+	return map_file(buffer.c_str(), mode, advice, offset, length);
+}
+
+template<typename T> TypedArray<T> map_typed(const char *path, map_mode mode = map_mode::copy_on_write, unsigned advice = advise_normal, uint64_t offset = 0, size_t length = 0) {
+	mapped_file	f(path, mode, offset, length);
+	f.advise(advice);
+	return f.template typed_array<T>();
+}
+
+}	// namespace Node
+#endif
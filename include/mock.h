@@ -0,0 +1,1727 @@
+#pragma once
+#include <node_api.h>
+#include <vector>
+#include <string>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <charconv>
+#include <algorithm>
+#include <utility>
+
+//-----------------------------------------------------------------------------
+//	mock host - an in-process stand-in for the napi_* functions, so node.h's templates can be benchmarked and tested in a plain native binary
+//	values live on a refcounted heap: handles, properties, elements and strong references each hold one count, and a value is freed (running its
+//	finalizers) the moment its count reaches zero, so results are deterministic and free of GC and JIT noise
+//	this defines the napi_* symbols, so include it in exactly one translation unit of a program that is not loaded by Node
+//	not modelled: running JS (napi_run_script fails), property attributes beyond enumerability, and collection of reference cycles
+//	async work and threadsafe function calls are queued, and run on the calling thread by napi_mock::run_async()
+//-----------------------------------------------------------------------------
+
+namespace napi_mock {
+enum class kind : uint8_t { plain, array, function, error, arraybuffer, typedarray, dataview, promise, date };
+
+struct finalizer {
+	node_api_nogc_finalize	cb;
+	void					*data, *hint;
+};
+struct property {
+	napi_value				key;		// a string or symbol
+	napi_value				value;		// null for accessors
+	napi_callback			getter, setter;
+	void					*data;
+	bool					enumerable;
+};
+}
+
+struct napi_value__ {
+	napi_valuetype				type;
+	napi_mock::kind				kind		= napi_mock::kind::plain;
+	int							refs		= 0;
+
+	bool						b			= false;	// boolean; bigint sign
+	double						d			= 0;		// number, date
+	std::string					s;						// string (as utf8), symbol description, function name
+	std::vector<uint64_t>		words;					// bigint magnitude
+
+	std::vector<napi_mock::property>	props;
+	std::vector<napi_value>		elements;				// arrays
+	napi_value					proto		= nullptr;
+
+	napi_callback				cb			= nullptr;	// functions
+	void						*data		= nullptr;	// function data, external pointer
+
+	void						*wrap		= nullptr;
+	napi_mock::finalizer		wrap_fin	= {};
+	std::vector<napi_mock::finalizer>	finalizers;		// external and napi_add_finalizer
+
+	uint8_t						*bytes		= nullptr;	// arraybuffers
+	size_t						length		= 0;		// bytes of an arraybuffer, elements of a typedarray, bytes of a dataview
+	bool						owned		= false, detached = false;
+
+	napi_typedarray_type		array_type	= napi_uint8_array;
+	napi_value					buffer		= nullptr;	// typedarrays and dataviews
+	size_t						offset		= 0;
+	bool						is_buffer	= false;
+
+	int							state		= 0;		// promises: 0 pending, 1 resolved, 2 rejected
+	napi_value					result		= nullptr;
+
+	bool						tagged		= false;
+	napi_type_tag				tag			= {};
+	std::vector<napi_ref>		weak;					// weak references to null when this is freed
+
+	explicit napi_value__(napi_valuetype type) : type(type) {}
+};
+
+struct napi_ref__ {
+	napi_value	v;
+	uint32_t	count;
+};
+
+struct napi_callback_info__ {
+	napi_value			this_arg, new_target;
+	size_t				argc;
+	const napi_value	*argv;
+	void				*data;
+};
+
+struct napi_async_work__ {
+	napi_async_execute_callback		execute;
+	napi_async_complete_callback	complete;
+	void							*data;
+	bool							queued = false, cancelled = false;
+};
+
+struct napi_threadsafe_function__ {
+	napi_threadsafe_function_call_js	call_js;
+	napi_value							func;
+	void								*context;
+	napi_finalize						finalize;
+	void								*finalize_data;
+	size_t								threads;
+	bool								closing = false;
+	std::deque<void*>					calls;
+};
+
+struct napi_env__ {
+	napi_value__				undefined_v{napi_undefined}, null_v{napi_null}, true_v{napi_boolean}, false_v{napi_boolean};
+	napi_value					global;
+	std::vector<napi_value>		handles;				// one count each; scopes pop back to their mark
+	napi_value					exception	= nullptr;
+	napi_extended_error_info	last_error	= {};
+	void						*instance_data = nullptr;
+	napi_finalize				instance_fin	= nullptr;
+	void						*instance_hint	= nullptr;
+	std::map<std::string, napi_value>	symbols;
+	std::vector<std::pair<napi_cleanup_hook, void*>>	cleanup;
+
+	std::mutex									queue_mutex;	// tsfn calls can come from any thread
+	std::deque<napi_async_work>					work;
+	std::vector<napi_threadsafe_function>		tsfns;
+
+	std::vector<napi_value>		free;					// freed cells, reused so timings do not include the allocator
+	size_t						live = 0, allocated = 0;
+	int64_t						external_memory = 0;
+};
+
+namespace napi_mock {
+
+//-----------------------------------------------------------------------------
+//	heap
+//-----------------------------------------------------------------------------
+
+static constexpr int permanent = 1 << 30;
+
+inline napi_env		host() {
+	static napi_env__	env;
+	static bool			init = [] {
+		for (auto v : {&env.undefined_v, &env.null_v, &env.true_v, &env.false_v})
+			v->refs = permanent;
+		env.true_v.b	= true;
+		env.global		= new napi_value__{napi_object};
+		env.global->refs = permanent;
+		return true;
+	}();
+	(void)init;
+	return &env;
+}
+
+inline void	hold(napi_value v)		{ if (v) ++v->refs; }
+void		release(napi_value v);
+
+inline void	run(const finalizer &f)	{ f.cb(host(), f.data, f.hint); }
+
+inline void	destroy(napi_value v) {
+	auto	env = host();
+	for (auto r : v->weak)
+		r->v = nullptr;
+	if (v->wrap && v->wrap_fin.cb)
+		run(v->wrap_fin);
+	for (auto &f : v->finalizers)
+		run(f);
+	if (v->owned)
+		delete[] v->bytes;
+	for (auto &p : v->props) {
+		release(p.key);
+		release(p.value);
+	}
+	for (auto e : v->elements)
+		release(e);
+	release(v->proto);
+	release(v->buffer);
+	release(v->result);
+	--env->live;
+	env->free.push_back(v);
+}
+
+inline void	release(napi_value v) {
+	if (v && --v->refs == 0)
+		destroy(v);
+}
+
+// owned by whatever stores it
+inline napi_value	alloc(napi_valuetype type, kind k = kind::plain) {
+	auto	env	= host();
+	napi_value	v;
+	if (env->free.empty()) {
+		v = new napi_value__{type};
+	} else {
+		v = env->free.back();
+		env->free.pop_back();
+		*v = napi_value__{type};
+	}
+	v->kind	= k;
+	++env->live;
+	++env->allocated;
+	return v;
+}
+
+// owned by the current handle scope
+inline napi_value	handle(napi_value v) {
+	hold(v);
+	host()->handles.push_back(v);
+	return v;
+}
+inline napi_value	make(napi_valuetype type, kind k = kind::plain) {
+	return handle(alloc(type, k));
+}
+
+inline napi_status	status(napi_env env, napi_status s) {
+	static const char *messages[] = {
+		nullptr, "Invalid argument", "An object was expected", "A string was expected", "A string or symbol was expected", "A function was expected",
+		"A number was expected", "A boolean was expected", "An array was expected", "Unknown failure", "An exception is pending", "The async work item was cancelled",
+		"napi_escape_handle already called on scope", "Invalid handle scope usage", "Invalid callback scope usage", "Thread-safe function queue is full",
+		"Thread-safe function handle is closing", "A bigint was expected", "A date was expected", "An arraybuffer was expected", "A detachable arraybuffer was expected",
+		"Main thread would deadlock", "External buffers are not allowed", "Cannot run JavaScript",
+	};
+	env->last_error.error_code		= s;
+	env->last_error.error_message	= s < sizeof(messages) / sizeof(messages[0]) ? messages[s] : "Unknown failure";
+	return s;
+}
+#define NAPI_MOCK_CHECK(x, s)	if (!(x)) return napi_mock::status(env, s)
+#define NAPI_MOCK_OK			return napi_mock::status(env, napi_ok)
+
+inline bool	is_object(napi_value v)	{ return v && (v->type == napi_object || v->type == napi_function || v->type == napi_external); }
+
+//-----------------------------------------------------------------------------
+//	strings
+//-----------------------------------------------------------------------------
+
+inline void	put_utf8(std::string &s, uint32_t c) {
+	if (c < 0x80) {
+		s += char(c);
+	} else if (c < 0x800) {
+		s += char(0xc0 | (c >> 6));
+		s += char(0x80 | (c & 0x3f));
+	} else if (c < 0x10000) {
+		s += char(0xe0 | (c >> 12));
+		s += char(0x80 | ((c >> 6) & 0x3f));
+		s += char(0x80 | (c & 0x3f));
+	} else {
+		s += char(0xf0 | (c >> 18));
+		s += char(0x80 | ((c >> 12) & 0x3f));
+		s += char(0x80 | ((c >> 6) & 0x3f));
+		s += char(0x80 | (c & 0x3f));
+	}
+}
+
+// the code point at s[i], advancing i
+inline uint32_t	get_utf8(const std::string &s, size_t &i) {
+	uint8_t		c	= s[i++];
+	int			n	= c < 0x80 ? 0 : c < 0xe0 ? 1 : c < 0xf0 ? 2 : 3;
+	uint32_t	r	= n ? c & (0x3f >> n) : c;
+	while (n-- && i < s.size())
+		r = (r << 6) | (s[i++] & 0x3f);
+	return r;
+}
+
+inline std::u16string	to_utf16(const std::string &s) {
+	std::u16string	r;
+	for (size_t i = 0; i < s.size();) {
+		auto	c = get_utf8(s, i);
+		if (c >= 0x10000) {
+			r += char16_t(0xd800 + ((c - 0x10000) >> 10));
+			r += char16_t(0xdc00 + (c & 0x3ff));
+		} else {
+			r += char16_t(c);
+		}
+	}
+	return r;
+}
+
+inline std::string	from_utf16(const char16_t *p, size_t n) {
+	std::string	r;
+	for (size_t i = 0; i < n; i++) {
+		uint32_t	c = p[i];
+		if (c >= 0xd800 && c < 0xdc00 && i + 1 < n && p[i + 1] >= 0xdc00 && p[i + 1] < 0xe000)
+			c = 0x10000 + ((c - 0xd800) << 10) + (p[++i] - 0xdc00);
+		put_utf8(r, c);
+	}
+	return r;
+}
+
+inline std::string	from_latin1(const char *p, size_t n) {
+	std::string	r;
+	for (size_t i = 0; i < n; i++)
+		put_utf8(r, uint8_t(p[i]));
+	return r;
+}
+
+inline napi_value	make_string(std::string s) {
+	auto	v = make(napi_string);
+	v->s = std::move(s);
+	return v;
+}
+
+// JS number to string, for coercion and array index keys
+inline std::string	number_string(double d) {
+	if (std::isnan(d))
+		return "NaN";
+	if (std::isinf(d))
+		return d < 0 ? "-Infinity" : "Infinity";
+	char	buf[32];
+	auto	r = std::to_chars(buf, buf + sizeof(buf), d);
+	return std::string(buf, r.ptr);
+}
+
+// copies with the usual napi contract: a null buffer asks for the length; the copy is truncated to whole characters and terminated
+template<typename C> napi_status	copy_string(napi_env env, const std::basic_string<C> &s, C *buf, size_t bufsize, size_t *result) {
+	if (!buf) {
+		NAPI_MOCK_CHECK(result, napi_invalid_arg);
+		*result = s.size();
+	} else if (bufsize) {
+		size_t	n = std::min(s.size(), bufsize - 1);
+		if constexpr (sizeof(C) == 1) {
+			while (n && n < s.size() && (s[n] & 0xc0) == 0x80)
+				--n;
+		} else {
+			if (n && n < s.size() && s[n - 1] >= 0xd800 && s[n - 1] < 0xdc00)
+				--n;
+		}
+		memcpy(buf, s.data(), n * sizeof(C));
+		buf[n] = 0;
+		if (result)
+			*result = n;
+	} else if (result) {
+		*result = 0;
+	}
+	NAPI_MOCK_OK;
+}
+
+//-----------------------------------------------------------------------------
+//	properties
+//-----------------------------------------------------------------------------
+
+inline bool	same_key(napi_value a, napi_value b) {
+	return a == b || (a->type == napi_string && b->type == napi_string && a->s == b->s);
+}
+
+inline property*	find_own(napi_value o, napi_value key) {
+	for (auto &p : o->props)
+		if (same_key(p.key, key))
+			return &p;
+	return nullptr;
+}
+inline property*	find_own(napi_value o, const char *name) {
+	for (auto &p : o->props)
+		if (p.key->type == napi_string && p.key->s == name)
+			return &p;
+	return nullptr;
+}
+template<typename K> property*	find(napi_value o, K key) {
+	for (; o; o = o->proto)
+		if (auto p = find_own(o, key))
+			return p;
+	return nullptr;
+}
+
+inline bool	array_index(napi_value key, uint32_t &i) {
+	if (key->type == napi_number) {
+		if (key->d < 0 || key->d >= 4294967295.0 || key->d != std::floor(key->d))
+			return false;
+		i = uint32_t(key->d);
+		return true;
+	}
+	if (key->type != napi_string || key->s.empty() || key->s.size() > 10 || (key->s[0] == '0' && key->s.size() > 1))
+		return false;
+	uint64_t	n = 0;
+	for (auto c : key->s) {
+		if (c < '0' || c > '9')
+			return false;
+		n = n * 10 + (c - '0');
+	}
+	if (n >= 4294967295u)
+		return false;
+	i = uint32_t(n);
+	return true;
+}
+
+inline napi_value	key_value(napi_value key) {
+	if (key->type == napi_number) {
+		auto	k = alloc(napi_string);
+		k->s = number_string(key->d);
+		return k;
+	}
+	hold(key);
+	return key;
+}
+
+inline void	set_own(napi_value o, napi_value key, napi_value v, bool enumerable = true) {
+	hold(v);
+	if (auto p = find_own(o, key)) {
+		release(p->value);
+		p->value	= v;
+		p->getter	= p->setter = nullptr;
+		return;
+	}
+	o->props.push_back({key_value(key), v, nullptr, nullptr, nullptr, enumerable});
+}
+inline void	set_own(napi_value o, const char *name, napi_value v, bool enumerable = true) {
+	auto	k = alloc(napi_string);
+	k->s = name;
+	hold(k);
+	set_own(o, k, v, enumerable);
+	release(k);
+}
+
+inline napi_value	make_number(double d) {
+	auto	v = make(napi_number);
+	v->d = d;
+	return v;
+}
+
+inline napi_value	typed_element(napi_value a, uint32_t i) {
+	if (i >= a->length || a->buffer->detached)
+		return nullptr;
+	auto	p = a->buffer->bytes + a->offset;
+	switch (a->array_type) {
+		case napi_int8_array:			return make_number(((int8_t*)p)[i]);
+		case napi_uint8_array:
+		case napi_uint8_clamped_array:	return make_number(((uint8_t*)p)[i]);
+		case napi_int16_array:			return make_number(((int16_t*)p)[i]);
+		case napi_uint16_array:			return make_number(((uint16_t*)p)[i]);
+		case napi_int32_array:			return make_number(((int32_t*)p)[i]);
+		case napi_uint32_array:			return make_number(((uint32_t*)p)[i]);
+		case napi_float32_array:		return make_number(((float*)p)[i]);
+		case napi_float64_array:		return make_number(((double*)p)[i]);
+		default:						return nullptr;
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	calls
+//-----------------------------------------------------------------------------
+
+// the result is left in the caller's scope, as V8 does
+inline napi_value	invoke(napi_env env, napi_callback cb, void *data, napi_value this_arg, size_t argc, const napi_value *argv, napi_value new_target = nullptr) {
+	auto	slot = env->handles.size();
+	env->handles.push_back(nullptr);
+	napi_callback_info__	info{this_arg, new_target, argc, argv, data};
+	napi_value	r = cb(env, &info);
+	hold(r);
+	for (auto n = env->handles.size(); n > slot + 1; --n) {
+		release(env->handles.back());
+		env->handles.pop_back();
+	}
+	env->handles[slot] = r;
+	return r ? r : &env->undefined_v;
+}
+
+inline napi_value	get(napi_env env, napi_value o, property *p) {
+	if (!p)
+		return &env->undefined_v;
+	if (p->getter)
+		return invoke(env, p->getter, p->data, o, 0, nullptr);
+	return p->value;
+}
+
+inline napi_value	make_error(napi_env env, napi_value code, napi_value msg, const char *name) {
+	auto	e = make(napi_object, kind::error);
+	set_own(e, "message", msg, false);
+	if (code)
+		set_own(e, "code", code);
+	auto	n = alloc(napi_string);
+	n->s = name;
+	hold(n);
+	set_own(e, "name", n, false);
+	release(n);
+	return e;
+}
+
+inline napi_value	make_arraybuffer(uint8_t *bytes, size_t length, bool owned) {
+	auto	a = make(napi_object, kind::arraybuffer);
+	a->bytes	= bytes;
+	a->length	= length;
+	a->owned	= owned;
+	return a;
+}
+
+inline napi_value	make_typedarray(napi_typedarray_type type, size_t length, napi_value buffer, size_t offset) {
+	auto	a = make(napi_object, kind::typedarray);
+	a->array_type	= type;
+	a->length		= length;
+	a->buffer		= buffer;
+	a->offset		= offset;
+	hold(buffer);
+	return a;
+}
+
+inline size_t	element_size(napi_typedarray_type t) {
+	switch (t) {
+		case napi_int8_array: case napi_uint8_array: case napi_uint8_clamped_array:	return 1;
+		case napi_int16_array: case napi_uint16_array:								return 2;
+		case napi_int32_array: case napi_uint32_array: case napi_float32_array:		return 4;
+		default:																	return 8;
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	host control
+//-----------------------------------------------------------------------------
+
+inline napi_env	env()		{ return host(); }
+inline size_t	live_values()	{ return host()->live; }
+inline size_t	allocated()		{ return host()->allocated; }
+
+// an exports object passed through init, as Node does when it loads an addon; it stays in the outermost scope
+inline napi_value	load(napi_value (*init)(napi_env, napi_value)) {
+	auto	env		= host();
+	auto	exports	= make(napi_object);
+	auto	r		= init(env, exports);
+	return r ? r : exports;
+}
+
+// runs queued async work (execute then complete) and threadsafe function calls on this thread, until none are left
+inline size_t	run_async() {
+	auto	env = host();
+	size_t	n	= 0;
+	for (;;) {
+		napi_async_work				w = nullptr;
+		napi_threadsafe_function	t = nullptr;
+		void						*call = nullptr;
+		{
+			std::lock_guard<std::mutex>	lock(env->queue_mutex);
+			if (!env->work.empty()) {
+				w = env->work.front();
+				env->work.pop_front();
+			} else {
+				for (auto f : env->tsfns) {
+					if (!f->calls.empty()) {
+						t		= f;
+						call	= f->calls.front();
+						f->calls.pop_front();
+						break;
+					}
+				}
+			}
+		}
+		auto	mark = env->handles.size();
+		if (w) {
+			w->queued = false;
+			if (!w->cancelled)
+				w->execute(env, w->data);
+			w->complete(env, w->cancelled ? napi_cancelled : napi_ok, w->data);
+		} else if (t) {
+			if (t->call_js)
+				t->call_js(env, t->func, t->context, call);
+			else if (t->func)
+				invoke(env, t->func->cb, t->func->data, &env->undefined_v, 0, nullptr);
+		} else {
+			break;
+		}
+		while (env->handles.size() > mark) {
+			release(env->handles.back());
+			env->handles.pop_back();
+		}
+		++n;
+
+		// finalize threadsafe functions that every thread has released and that have no calls left
+		std::vector<napi_threadsafe_function>	done;
+		{
+			std::lock_guard<std::mutex>	lock(env->queue_mutex);
+			for (auto i = env->tsfns.begin(); i != env->tsfns.end();) {
+				if (((*i)->threads == 0 || (*i)->closing) && (*i)->calls.empty()) {
+					done.push_back(*i);
+					i = env->tsfns.erase(i);
+				} else {
+					++i;
+				}
+			}
+		}
+		for (auto f : done) {
+			if (f->finalize)
+				f->finalize(env, f->finalize_data, f->context);
+			release(f->func);
+			delete f;
+		}
+	}
+	return n;
+}
+
+// {state, result} of a promise made by napi_create_promise: 0 pending, 1 resolved, 2 rejected
+inline int	promise_state(napi_value p, napi_value *result = nullptr) {
+	if (result)
+		*result = p->result;
+	return p->state;
+}
+
+inline napi_value	exchange_exception(napi_env env, napi_value e = nullptr) {
+	auto	r = env->exception;
+	env->exception = e;
+	return r;
+}
+
+// drops every handle in the outermost scope and runs the cleanup hooks and instance data finalizer
+inline void	reset() {
+	auto	env = host();
+	while (!env->handles.empty()) {
+		release(env->handles.back());
+		env->handles.pop_back();
+	}
+	release(exchange_exception(env));
+	for (auto i = env->cleanup.rbegin(); i != env->cleanup.rend(); ++i)
+		i->first(i->second);
+	env->cleanup.clear();
+	if (env->instance_fin)
+		env->instance_fin(env, env->instance_data, env->instance_hint);
+	env->instance_data	= nullptr;
+	env->instance_fin	= nullptr;
+}
+
+} // namespace napi_mock
+
+//-----------------------------------------------------------------------------
+//	napi_* definitions
+//-----------------------------------------------------------------------------
+
+extern "C" {
+using namespace napi_mock;
+
+napi_status NAPI_CDECL napi_get_last_error_info(node_api_nogc_env env, const napi_extended_error_info** result) {
+	*result = &((napi_env)env)->last_error;
+	return napi_ok;
+}
+
+napi_status NAPI_CDECL napi_get_undefined(napi_env env, napi_value* result)			{ *result = &env->undefined_v; NAPI_MOCK_OK; }
+napi_status NAPI_CDECL napi_get_null(napi_env env, napi_value* result)				{ *result = &env->null_v; NAPI_MOCK_OK; }
+napi_status NAPI_CDECL napi_get_global(napi_env env, napi_value* result)			{ *result = env->global; NAPI_MOCK_OK; }
+napi_status NAPI_CDECL napi_get_boolean(napi_env env, bool value, napi_value* result)	{ *result = value ? &env->true_v : &env->false_v; NAPI_MOCK_OK; }
+
+napi_status NAPI_CDECL napi_create_object(napi_env env, napi_value* result)			{ *result = make(napi_object); NAPI_MOCK_OK; }
+napi_status NAPI_CDECL napi_create_array(napi_env env, napi_value* result)			{ *result = make(napi_object, kind::array); NAPI_MOCK_OK; }
+napi_status NAPI_CDECL napi_create_array_with_length(napi_env env, size_t length, napi_value* result) {
+	auto	a = make(napi_object, kind::array);
+	a->elements.resize(length, nullptr);
+	*result = a;
+	NAPI_MOCK_OK;
+}
+
+napi_status NAPI_CDECL napi_create_double(napi_env env, double value, napi_value* result)	{ *result = make_number(value); NAPI_MOCK_OK; }
+napi_status NAPI_CDECL napi_create_int32(napi_env env, int32_t value, napi_value* result)	{ *result = make_number(value); NAPI_MOCK_OK; }
+napi_status NAPI_CDECL napi_create_uint32(napi_env env, uint32_t value, napi_value* result)	{ *result = make_number(value); NAPI_MOCK_OK; }
+napi_status NAPI_CDECL napi_create_int64(napi_env env, int64_t value, napi_value* result)	{ *result = make_number(double(value)); NAPI_MOCK_OK; }
+
+napi_status NAPI_CDECL napi_create_string_latin1(napi_env env, const char* str, size_t length, napi_value* result) {
+	*result = make_string(from_latin1(str, length == NAPI_AUTO_LENGTH ? strlen(str) : length));
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_create_string_utf8(napi_env env, const char* str, size_t length, napi_value* result) {
+	*result = make_string(std::string(str, length == NAPI_AUTO_LENGTH ? strlen(str) : length));
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_create_string_utf16(napi_env env, const char16_t* str, size_t length, napi_value* result) {
+	if (length == NAPI_AUTO_LENGTH)
+		length = std::char_traits<char16_t>::length(str);
+	*result = make_string(from_utf16(str, length));
+	NAPI_MOCK_OK;
+}
+
+#if NAPI_VERSION >= 10
+// always copied, as V8 does for short strings
+napi_status NAPI_CDECL node_api_create_external_string_latin1(napi_env env, char* str, size_t length, node_api_nogc_finalize finalize_callback, void* finalize_hint, napi_value* result, bool* copied) {
+	napi_create_string_latin1(env, str, length, result);
+	if (copied)
+		*copied = true;
+	if (finalize_callback)
+		finalize_callback(env, str, finalize_hint);
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL node_api_create_external_string_utf16(napi_env env, char16_t* str, size_t length, node_api_nogc_finalize finalize_callback, void* finalize_hint, napi_value* result, bool* copied) {
+	napi_create_string_utf16(env, str, length, result);
+	if (copied)
+		*copied = true;
+	if (finalize_callback)
+		finalize_callback(env, str, finalize_hint);
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL node_api_create_property_key_latin1(napi_env env, const char* str, size_t length, napi_value* result)		{ return napi_create_string_latin1(env, str, length, result); }
+napi_status NAPI_CDECL node_api_create_property_key_utf8(napi_env env, const char* str, size_t length, napi_value* result)		{ return napi_create_string_utf8(env, str, length, result); }
+napi_status NAPI_CDECL node_api_create_property_key_utf16(napi_env env, const char16_t* str, size_t length, napi_value* result)	{ return napi_create_string_utf16(env, str, length, result); }
+#endif
+
+napi_status NAPI_CDECL napi_create_symbol(napi_env env, napi_value description, napi_value* result) {
+	auto	v = make(napi_symbol);
+	if (description)
+		v->s = description->s;
+	*result = v;
+	NAPI_MOCK_OK;
+}
+#if NAPI_VERSION >= 9
+napi_status NAPI_CDECL node_api_symbol_for(napi_env env, const char* utf8description, size_t length, napi_value* result) {
+	std::string	key(utf8description, length == NAPI_AUTO_LENGTH ? strlen(utf8description) : length);
+	auto	&v = env->symbols[key];
+	if (!v) {
+		v = alloc(napi_symbol);
+		v->s	= key;
+		v->refs	= permanent;
+	}
+	*result = v;
+	NAPI_MOCK_OK;
+}
+#endif
+
+napi_status NAPI_CDECL napi_create_function(napi_env env, const char* utf8name, size_t length, napi_callback cb, void* data, napi_value* result) {
+	NAPI_MOCK_CHECK(cb, napi_invalid_arg);
+	auto	f = make(napi_function, kind::function);
+	if (utf8name)
+		f->s.assign(utf8name, length == NAPI_AUTO_LENGTH ? strlen(utf8name) : length);
+	f->cb	= cb;
+	f->data	= data;
+	*result = f;
+	NAPI_MOCK_OK;
+}
+
+napi_status NAPI_CDECL napi_create_error(napi_env env, napi_value code, napi_value msg, napi_value* result) {
+	NAPI_MOCK_CHECK(msg && msg->type == napi_string, napi_string_expected);
+	*result = make_error(env, code, msg, "Error");
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_create_type_error(napi_env env, napi_value code, napi_value msg, napi_value* result) {
+	NAPI_MOCK_CHECK(msg && msg->type == napi_string, napi_string_expected);
+	*result = make_error(env, code, msg, "TypeError");
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_create_range_error(napi_env env, napi_value code, napi_value msg, napi_value* result) {
+	NAPI_MOCK_CHECK(msg && msg->type == napi_string, napi_string_expected);
+	*result = make_error(env, code, msg, "RangeError");
+	NAPI_MOCK_OK;
+}
+#if NAPI_VERSION >= 9
+napi_status NAPI_CDECL node_api_create_syntax_error(napi_env env, napi_value code, napi_value msg, napi_value* result) {
+	NAPI_MOCK_CHECK(msg && msg->type == napi_string, napi_string_expected);
+	*result = make_error(env, code, msg, "SyntaxError");
+	NAPI_MOCK_OK;
+}
+#endif
+
+napi_status NAPI_CDECL napi_typeof(napi_env env, napi_value value, napi_valuetype* result) {
+	NAPI_MOCK_CHECK(value, napi_invalid_arg);
+	*result = value->type;
+	NAPI_MOCK_OK;
+}
+
+napi_status NAPI_CDECL napi_get_value_double(napi_env env, napi_value value, double* result) {
+	NAPI_MOCK_CHECK(value && value->type == napi_number, napi_number_expected);
+	*result = value->d;
+	NAPI_MOCK_OK;
+}
+// ToInt32 / ToUint32: modulo 2^32, with non-finite values giving 0
+napi_status NAPI_CDECL napi_get_value_int32(napi_env env, napi_value value, int32_t* result) {
+	NAPI_MOCK_CHECK(value && value->type == napi_number, napi_number_expected);
+	*result = std::isfinite(value->d) ? int32_t(uint32_t(int64_t(std::fmod(std::trunc(value->d), 4294967296.0)))) : 0;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_get_value_uint32(napi_env env, napi_value value, uint32_t* result) {
+	NAPI_MOCK_CHECK(value && value->type == napi_number, napi_number_expected);
+	*result = std::isfinite(value->d) ? uint32_t(int64_t(std::fmod(std::trunc(value->d), 4294967296.0))) : 0;
+	NAPI_MOCK_OK;
+}
+// saturates outside the int64 range
+napi_status NAPI_CDECL napi_get_value_int64(napi_env env, napi_value value, int64_t* result) {
+	NAPI_MOCK_CHECK(value && value->type == napi_number, napi_number_expected);
+	auto	d = value->d;
+	*result = !std::isfinite(d) ? 0 : d >= 9223372036854775808.0 ? INT64_MAX : d <= -9223372036854775808.0 ? INT64_MIN : int64_t(d);
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_get_value_bool(napi_env env, napi_value value, bool* result) {
+	NAPI_MOCK_CHECK(value && value->type == napi_boolean, napi_boolean_expected);
+	*result = value->b;
+	NAPI_MOCK_OK;
+}
+
+napi_status NAPI_CDECL napi_get_value_string_latin1(napi_env env, napi_value value, char* buf, size_t bufsize, size_t* result) {
+	NAPI_MOCK_CHECK(value && value->type == napi_string, napi_string_expected);
+	std::string	s;
+	for (size_t i = 0; i < value->s.size();)
+		s += char(get_utf8(value->s, i));
+	return copy_string(env, s, buf, bufsize, result);
+}
+napi_status NAPI_CDECL napi_get_value_string_utf8(napi_env env, napi_value value, char* buf, size_t bufsize, size_t* result) {
+	NAPI_MOCK_CHECK(value && value->type == napi_string, napi_string_expected);
+	return copy_string(env, value->s, buf, bufsize, result);
+}
+napi_status NAPI_CDECL napi_get_value_string_utf16(napi_env env, napi_value value, char16_t* buf, size_t bufsize, size_t* result) {
+	NAPI_MOCK_CHECK(value && value->type == napi_string, napi_string_expected);
+	return copy_string(env, to_utf16(value->s), buf, bufsize, result);
+}
+
+napi_status NAPI_CDECL napi_coerce_to_bool(napi_env env, napi_value value, napi_value* result) {
+	NAPI_MOCK_CHECK(value, napi_invalid_arg);
+	bool	b;
+	switch (value->type) {
+		case napi_undefined: case napi_null:	b = false; break;
+		case napi_boolean:						b = value->b; break;
+		case napi_number:						b = value->d != 0 && !std::isnan(value->d); break;
+		case napi_string:						b = !value->s.empty(); break;
+		case napi_bigint:						b = !value->words.empty(); break;
+		default:								b = true; break;
+	}
+	return napi_get_boolean(env, b, result);
+}
+napi_status NAPI_CDECL napi_coerce_to_number(napi_env env, napi_value value, napi_value* result) {
+	NAPI_MOCK_CHECK(value, napi_invalid_arg);
+	double	d = NAN;
+	switch (value->type) {
+		case napi_null:		d = 0; break;
+		case napi_boolean:	d = value->b; break;
+		case napi_number:	d = value->d; break;
+		case napi_string: {
+			auto	b = value->s.find_first_not_of(" \t\n\r");
+			auto	e = value->s.find_last_not_of(" \t\n\r");
+			if (b == std::string::npos) {
+				d = 0;
+			} else {
+				auto	t = value->s.substr(b, e - b + 1);
+				char	*end;
+				d = strtod(t.c_str(), &end);
+				if (*end)
+					d = NAN;
+			}
+			break;
+		}
+		case napi_bigint:
+		case napi_symbol:	return status(env, napi_number_expected);
+		default:			if (value->kind == kind::date) d = value->d; break;
+	}
+	*result = make_number(d);
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_coerce_to_object(napi_env env, napi_value value, napi_value* result) {
+	NAPI_MOCK_CHECK(value && value->type != napi_undefined && value->type != napi_null, napi_object_expected);
+	if (is_object(value)) {
+		*result = value;
+	} else {
+		auto	o = make(napi_object);
+		set_own(o, "valueOf", value, false);
+		*result = o;
+	}
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_coerce_to_string(napi_env env, napi_value value, napi_value* result) {
+	NAPI_MOCK_CHECK(value && value->type != napi_symbol, napi_string_expected);
+	switch (value->type) {
+		case napi_undefined:	*result = make_string("undefined"); break;
+		case napi_null:			*result = make_string("null"); break;
+		case napi_boolean:		*result = make_string(value->b ? "true" : "false"); break;
+		case napi_number:		*result = make_string(number_string(value->d)); break;
+		case napi_string:		*result = value; break;
+		default:				*result = make_string(value->kind == kind::array ? "" : value->kind == kind::function ? "function" : "[object Object]"); break;
+	}
+	NAPI_MOCK_OK;
+}
+
+napi_status NAPI_CDECL napi_get_prototype(napi_env env, napi_value object, napi_value* result) {
+	NAPI_MOCK_CHECK(is_object(object), napi_object_expected);
+	*result = object->proto ? object->proto : &env->null_v;
+	NAPI_MOCK_OK;
+}
+
+napi_status NAPI_CDECL napi_get_all_property_names(napi_env env, napi_value object, napi_key_collection_mode key_mode, napi_key_filter key_filter, napi_key_conversion key_conversion, napi_value* result) {
+	NAPI_MOCK_CHECK(is_object(object), napi_object_expected);
+	auto	a = make(napi_object, kind::array);
+	for (auto o = object; o; o = key_mode == napi_key_own_only ? nullptr : o->proto) {
+		if (o->kind == kind::array && !(key_filter & napi_key_skip_strings)) {
+			for (uint32_t i = 0; i < o->elements.size(); i++) {
+				if (o->elements[i]) {
+					auto	k = key_conversion == napi_key_numbers_to_strings ? alloc(napi_string) : alloc(napi_number);
+					if (k->type == napi_string)
+						k->s = number_string(i);
+					else
+						k->d = i;
+					hold(k);
+					a->elements.push_back(k);
+				}
+			}
+		}
+		for (auto &p : o->props) {
+			if ((key_filter & napi_key_enumerable) && !p.enumerable)
+				continue;
+			if ((key_filter & (p.key->type == napi_symbol ? napi_key_skip_symbols : napi_key_skip_strings)))
+				continue;
+			hold(p.key);
+			a->elements.push_back(p.key);
+		}
+	}
+	*result = a;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_get_property_names(napi_env env, napi_value object, napi_value* result) {
+	return napi_get_all_property_names(env, object, napi_key_include_prototypes, napi_key_filter(napi_key_enumerable | napi_key_skip_symbols), napi_key_numbers_to_strings, result);
+}
+
+napi_status NAPI_CDECL napi_set_element(napi_env env, napi_value object, uint32_t index, napi_value value);
+napi_status NAPI_CDECL napi_get_element(napi_env env, napi_value object, uint32_t index, napi_value* result);
+
+napi_status NAPI_CDECL napi_set_property(napi_env env, napi_value object, napi_value key, napi_value value) {
+	NAPI_MOCK_CHECK(is_object(object), napi_object_expected);
+	NAPI_MOCK_CHECK(key && value, napi_invalid_arg);
+	uint32_t	i;
+	if ((object->kind == kind::array || object->kind == kind::typedarray) && array_index(key, i))
+		return napi_set_element(env, object, i, value);
+	if (auto p = find(object, key); p && p->setter) {
+		invoke(env, p->setter, p->data, object, 1, &value);
+		NAPI_MOCK_OK;
+	}
+	set_own(object, key, value);
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_has_property(napi_env env, napi_value object, napi_value key, bool* result) {
+	NAPI_MOCK_CHECK(is_object(object), napi_object_expected);
+	uint32_t	i;
+	if (object->kind == kind::array && array_index(key, i))
+		*result = i < object->elements.size() && object->elements[i];
+	else
+		*result = !!find(object, key);
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_get_property(napi_env env, napi_value object, napi_value key, napi_value* result) {
+	NAPI_MOCK_CHECK(is_object(object), napi_object_expected);
+	NAPI_MOCK_CHECK(key, napi_invalid_arg);
+	uint32_t	i;
+	if ((object->kind == kind::array || object->kind == kind::typedarray) && array_index(key, i))
+		return napi_get_element(env, object, i, result);
+	if (object->kind == kind::array && key->type == napi_string && key->s == "length") {
+		*result = make_number(object->elements.size());
+		NAPI_MOCK_OK;
+	}
+	*result = get(env, object, find(object, key));
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_delete_property(napi_env env, napi_value object, napi_value key, bool* result) {
+	NAPI_MOCK_CHECK(is_object(object), napi_object_expected);
+	uint32_t	i;
+	if (object->kind == kind::array && array_index(key, i)) {
+		if (i < object->elements.size())
+			release(std::exchange(object->elements[i], nullptr));
+	} else if (auto p = find_own(object, key)) {
+		release(p->key);
+		release(p->value);
+		object->props.erase(object->props.begin() + (p - object->props.data()));
+	}
+	if (result)
+		*result = true;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_has_own_property(napi_env env, napi_value object, napi_value key, bool* result) {
+	NAPI_MOCK_CHECK(is_object(object), napi_object_expected);
+	NAPI_MOCK_CHECK(key && (key->type == napi_string || key->type == napi_symbol), napi_name_expected);
+	uint32_t	i;
+	if (object->kind == kind::array && array_index(key, i))
+		*result = i < object->elements.size() && object->elements[i];
+	else
+		*result = !!find_own(object, key);
+	NAPI_MOCK_OK;
+}
+
+napi_status NAPI_CDECL napi_set_named_property(napi_env env, napi_value object, const char* utf8name, napi_value value) {
+	NAPI_MOCK_CHECK(is_object(object), napi_object_expected);
+	NAPI_MOCK_CHECK(utf8name && value, napi_invalid_arg);
+	if (auto p = find(object, utf8name); p && p->setter) {
+		invoke(env, p->setter, p->data, object, 1, &value);
+		NAPI_MOCK_OK;
+	}
+	if (auto p = find_own(object, utf8name)) {
+		hold(value);
+		release(p->value);
+		p->value = value;
+		NAPI_MOCK_OK;
+	}
+	set_own(object, utf8name, value);
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_has_named_property(napi_env env, napi_value object, const char* utf8name, bool* result) {
+	NAPI_MOCK_CHECK(is_object(object), napi_object_expected);
+	*result = !!find(object, utf8name);
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_get_named_property(napi_env env, napi_value object, const char* utf8name, napi_value* result) {
+	NAPI_MOCK_CHECK(is_object(object), napi_object_expected);
+	NAPI_MOCK_CHECK(utf8name, napi_invalid_arg);
+	if ((object->kind == kind::array || object->kind == kind::typedarray) && strcmp(utf8name, "length") == 0) {
+		*result = make_number(object->kind == kind::array ? object->elements.size() : object->length);
+		NAPI_MOCK_OK;
+	}
+	*result = get(env, object, find(object, utf8name));
+	NAPI_MOCK_OK;
+}
+
+napi_status NAPI_CDECL napi_set_element(napi_env env, napi_value object, uint32_t index, napi_value value) {
+	NAPI_MOCK_CHECK(is_object(object), napi_object_expected);
+	NAPI_MOCK_CHECK(value, napi_invalid_arg);
+	if (object->kind == kind::typedarray) {
+		if (index < object->length && !object->buffer->detached && value->type == napi_number) {
+			auto	p = object->buffer->bytes + object->offset;
+			auto	d = value->d;
+			switch (object->array_type) {
+				case napi_int8_array:			((int8_t*)p)[index]		= int8_t(int64_t(d)); break;
+				case napi_uint8_array:			((uint8_t*)p)[index]	= uint8_t(int64_t(d)); break;
+				case napi_uint8_clamped_array:	((uint8_t*)p)[index]	= uint8_t(d < 0 ? 0 : d > 255 ? 255 : std::nearbyint(d)); break;
+				case napi_int16_array:			((int16_t*)p)[index]	= int16_t(int64_t(d)); break;
+				case napi_uint16_array:			((uint16_t*)p)[index]	= uint16_t(int64_t(d)); break;
+				case napi_int32_array:			((int32_t*)p)[index]	= int32_t(int64_t(d)); break;
+				case napi_uint32_array:			((uint32_t*)p)[index]	= uint32_t(int64_t(d)); break;
+				case napi_float32_array:		((float*)p)[index]		= float(d); break;
+				case napi_float64_array:		((double*)p)[index]		= d; break;
+				default: break;
+			}
+		}
+		NAPI_MOCK_OK;
+	}
+	if (object->kind != kind::array) {
+		auto	k = alloc(napi_number);
+		k->d = index;
+		hold(k);
+		auto	s = napi_set_property(env, object, k, value);
+		release(k);
+		return s;
+	}
+	if (index >= object->elements.size())
+		object->elements.resize(index + 1, nullptr);
+	hold(value);
+	release(std::exchange(object->elements[index], value));
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_has_element(napi_env env, napi_value object, uint32_t index, bool* result) {
+	NAPI_MOCK_CHECK(is_object(object), napi_object_expected);
+	*result = object->kind == kind::array ? index < object->elements.size() && object->elements[index] : object->kind == kind::typedarray && index < object->length;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_get_element(napi_env env, napi_value object, uint32_t index, napi_value* result) {
+	NAPI_MOCK_CHECK(is_object(object), napi_object_expected);
+	napi_value	r = nullptr;
+	if (object->kind == kind::array) {
+		if (index < object->elements.size())
+			r = object->elements[index];
+	} else if (object->kind == kind::typedarray) {
+		r = typed_element(object, index);
+	} else {
+		auto	k = alloc(napi_string);
+		k->s = number_string(index);
+		hold(k);
+		r = get(env, object, find(object, k));
+		release(k);
+	}
+	*result = r ? r : &env->undefined_v;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_delete_element(napi_env env, napi_value object, uint32_t index, bool* result) {
+	auto	k = alloc(napi_number);
+	k->d = index;
+	hold(k);
+	auto	s = napi_delete_property(env, object, k, result);
+	release(k);
+	return s;
+}
+
+napi_status NAPI_CDECL napi_define_properties(napi_env env, napi_value object, size_t property_count, const napi_property_descriptor* properties) {
+	NAPI_MOCK_CHECK(is_object(object), napi_object_expected);
+	for (size_t i = 0; i < property_count; i++) {
+		auto	&d = properties[i];
+		napi_value	key;
+		if (d.utf8name) {
+			key = alloc(napi_string);
+			key->s = d.utf8name;
+		} else {
+			NAPI_MOCK_CHECK(d.name, napi_name_expected);
+			key = d.name;
+		}
+		hold(key);
+		bool	enumerable = d.attributes & napi_enumerable;
+		if (d.getter || d.setter) {
+			if (auto p = find_own(object, key)) {
+				release(p->value);
+				*p = {p->key, nullptr, d.getter, d.setter, d.data, enumerable};
+			} else {
+				hold(key);
+				object->props.push_back({key, nullptr, d.getter, d.setter, d.data, enumerable});
+			}
+		} else if (d.method) {
+			auto	f = alloc(napi_function, kind::function);
+			f->s	= key->s;
+			f->cb	= d.method;
+			f->data	= d.data;
+			hold(f);
+			set_own(object, key, f, enumerable);
+			release(f);
+		} else {
+			set_own(object, key, d.value ? d.value : &env->undefined_v, enumerable);
+		}
+		release(key);
+	}
+	NAPI_MOCK_OK;
+}
+
+napi_status NAPI_CDECL napi_is_array(napi_env env, napi_value value, bool* result)	{ *result = value && value->kind == kind::array; NAPI_MOCK_OK; }
+napi_status NAPI_CDECL napi_get_array_length(napi_env env, napi_value value, uint32_t* result) {
+	NAPI_MOCK_CHECK(value && value->kind == kind::array, napi_array_expected);
+	*result = uint32_t(value->elements.size());
+	NAPI_MOCK_OK;
+}
+
+napi_status NAPI_CDECL napi_strict_equals(napi_env env, napi_value lhs, napi_value rhs, bool* result) {
+	NAPI_MOCK_CHECK(lhs && rhs, napi_invalid_arg);
+	if (lhs->type != rhs->type)
+		*result = false;
+	else if (lhs->type == napi_number)
+		*result = lhs->d == rhs->d;
+	else if (lhs->type == napi_string)
+		*result = lhs->s == rhs->s;
+	else if (lhs->type == napi_boolean)
+		*result = lhs->b == rhs->b;
+	else if (lhs->type == napi_bigint)
+		*result = lhs->b == rhs->b && lhs->words == rhs->words;
+	else
+		*result = lhs == rhs || lhs->type == napi_undefined || lhs->type == napi_null;
+	NAPI_MOCK_OK;
+}
+
+napi_status NAPI_CDECL napi_call_function(napi_env env, napi_value recv, napi_value func, size_t argc, const napi_value* argv, napi_value* result) {
+	NAPI_MOCK_CHECK(func && func->type == napi_function, napi_function_expected);
+	NAPI_MOCK_CHECK(!env->exception, napi_pending_exception);
+	auto	r = invoke(env, func->cb, func->data, recv ? recv : &env->undefined_v, argc, argv);
+	if (env->exception)
+		return status(env, napi_pending_exception);
+	if (result)
+		*result = r;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_make_callback(napi_env env, napi_async_context async_context, napi_value recv, napi_value func, size_t argc, const napi_value* argv, napi_value* result) {
+	return napi_call_function(env, recv, func, argc, argv, result);
+}
+
+napi_status NAPI_CDECL napi_new_instance(napi_env env, napi_value constructor, size_t argc, const napi_value* argv, napi_value* result) {
+	NAPI_MOCK_CHECK(constructor && constructor->type == napi_function, napi_function_expected);
+	NAPI_MOCK_CHECK(!env->exception, napi_pending_exception);
+	auto	obj = make(napi_object);
+	auto	p	= find_own(constructor, "prototype");
+	if (p && p->value && is_object(p->value)) {
+		obj->proto = p->value;
+		hold(obj->proto);
+	}
+	auto	r = invoke(env, constructor->cb, constructor->data, obj, argc, argv, constructor);
+	if (env->exception)
+		return status(env, napi_pending_exception);
+	*result = is_object(r) ? r : obj;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_instanceof(napi_env env, napi_value object, napi_value constructor, bool* result) {
+	NAPI_MOCK_CHECK(constructor && constructor->type == napi_function, napi_function_expected);
+	auto	p = find_own(constructor, "prototype");
+	*result = false;
+	if (is_object(object) && p && p->value) {
+		for (auto o = object->proto; o && !*result; o = o->proto)
+			*result = o == p->value;
+	}
+	NAPI_MOCK_OK;
+}
+
+napi_status NAPI_CDECL napi_get_cb_info(napi_env env, napi_callback_info cbinfo, size_t* argc, napi_value* argv, napi_value* this_arg, void** data) {
+	if (argv) {
+		for (size_t i = 0; i < *argc; i++)
+			argv[i] = i < cbinfo->argc ? cbinfo->argv[i] : &env->undefined_v;
+	}
+	if (argc)
+		*argc = cbinfo->argc;
+	if (this_arg)
+		*this_arg = cbinfo->this_arg;
+	if (data)
+		*data = cbinfo->data;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_get_new_target(napi_env env, napi_callback_info cbinfo, napi_value* result) {
+	*result = cbinfo->new_target;
+	NAPI_MOCK_OK;
+}
+
+napi_status NAPI_CDECL napi_define_class(napi_env env, const char* utf8name, size_t length, napi_callback constructor, void* data, size_t property_count, const napi_property_descriptor* properties, napi_value* result) {
+	NAPI_MOCK_CHECK(constructor, napi_invalid_arg);
+	napi_value	cons;
+	napi_create_function(env, utf8name, length, constructor, data, &cons);
+	auto	proto = make(napi_object);
+	set_own(cons, "prototype", proto, false);
+	for (size_t i = 0; i < property_count; i++) {
+		auto	s = napi_define_properties(env, properties[i].attributes & napi_static ? cons : proto, 1, properties + i);
+		if (s != napi_ok)
+			return s;
+	}
+	*result = cons;
+	NAPI_MOCK_OK;
+}
+
+napi_status NAPI_CDECL napi_wrap(napi_env env, napi_value js_object, void* native_object, node_api_nogc_finalize finalize_cb, void* finalize_hint, napi_ref* result) {
+	NAPI_MOCK_CHECK(is_object(js_object) && !js_object->wrap, napi_invalid_arg);
+	js_object->wrap		= native_object;
+	js_object->wrap_fin	= {finalize_cb, native_object, finalize_hint};
+	if (result)
+		napi_create_reference(env, js_object, 0, result);
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_unwrap(napi_env env, napi_value js_object, void** result) {
+	NAPI_MOCK_CHECK(is_object(js_object) && js_object->wrap, napi_invalid_arg);
+	*result = js_object->wrap;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_remove_wrap(napi_env env, napi_value js_object, void** result) {
+	NAPI_MOCK_CHECK(is_object(js_object) && js_object->wrap, napi_invalid_arg);
+	if (result)
+		*result = js_object->wrap;
+	js_object->wrap		= nullptr;
+	js_object->wrap_fin	= {};
+	NAPI_MOCK_OK;
+}
+
+napi_status NAPI_CDECL napi_create_external(napi_env env, void* data, node_api_nogc_finalize finalize_cb, void* finalize_hint, napi_value* result) {
+	auto	v = make(napi_external);
+	v->data = data;
+	if (finalize_cb)
+		v->finalizers.push_back({finalize_cb, data, finalize_hint});
+	*result = v;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_get_value_external(napi_env env, napi_value value, void** result) {
+	NAPI_MOCK_CHECK(value && value->type == napi_external, napi_invalid_arg);
+	*result = value->data;
+	NAPI_MOCK_OK;
+}
+
+//	references: a count above zero holds the value, zero leaves it weak
+
+napi_status NAPI_CDECL napi_create_reference(napi_env env, napi_value value, uint32_t initial_refcount, napi_ref* result) {
+	NAPI_MOCK_CHECK(value, napi_invalid_arg);
+#if NAPI_VERSION < 10
+	// as Node: only objects, functions and symbols until version 10
+	NAPI_MOCK_CHECK(is_object(value) || value->type == napi_symbol, napi_invalid_arg);
+#endif
+	auto	r = new napi_ref__{value, initial_refcount};
+	if (initial_refcount)
+		hold(value);
+	else
+		value->weak.push_back(r);
+	*result = r;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_delete_reference(napi_env env, napi_ref ref) {
+	NAPI_MOCK_CHECK(ref, napi_invalid_arg);
+	if (ref->v) {
+		if (ref->count) {
+			release(ref->v);
+		} else {
+			auto	&w = ref->v->weak;
+			w.erase(std::find(w.begin(), w.end(), ref));
+		}
+	}
+	delete ref;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_reference_ref(napi_env env, napi_ref ref, uint32_t* result) {
+	NAPI_MOCK_CHECK(ref, napi_invalid_arg);
+	if (ref->count++ == 0 && ref->v) {
+		auto	&w = ref->v->weak;
+		w.erase(std::find(w.begin(), w.end(), ref));
+		hold(ref->v);
+	}
+	if (result)
+		*result = ref->count;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_reference_unref(napi_env env, napi_ref ref, uint32_t* result) {
+	NAPI_MOCK_CHECK(ref && ref->count, napi_generic_failure);
+	if (--ref->count == 0 && ref->v) {
+		ref->v->weak.push_back(ref);
+		release(ref->v);
+	}
+	if (result)
+		*result = ref->count;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_get_reference_value(napi_env env, napi_ref ref, napi_value* result) {
+	NAPI_MOCK_CHECK(ref, napi_invalid_arg);
+	*result = ref->v ? handle(ref->v) : nullptr;
+	NAPI_MOCK_OK;
+}
+
+//	handle scopes are marks in the handle stack; an escapable scope reserves the slot below its mark for the escapee
+
+napi_status NAPI_CDECL napi_open_handle_scope(napi_env env, napi_handle_scope* result) {
+	*result = (napi_handle_scope)(env->handles.size() + 1);
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_close_handle_scope(napi_env env, napi_handle_scope scope) {
+	auto	mark = size_t(scope) - 1;
+	NAPI_MOCK_CHECK(mark <= env->handles.size(), napi_handle_scope_mismatch);
+	while (env->handles.size() > mark) {
+		release(env->handles.back());
+		env->handles.pop_back();
+	}
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_open_escapable_handle_scope(napi_env env, napi_escapable_handle_scope* result) {
+	env->handles.push_back(nullptr);
+	*result = (napi_escapable_handle_scope)(env->handles.size() + 1);
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_close_escapable_handle_scope(napi_env env, napi_escapable_handle_scope scope) {
+	return napi_close_handle_scope(env, (napi_handle_scope)scope);
+}
+napi_status NAPI_CDECL napi_escape_handle(napi_env env, napi_escapable_handle_scope scope, napi_value escapee, napi_value* result) {
+	auto	slot = size_t(scope) - 2;
+	NAPI_MOCK_CHECK(slot < env->handles.size(), napi_handle_scope_mismatch);
+	NAPI_MOCK_CHECK(!env->handles[slot], napi_escape_called_twice);
+	hold(escapee);
+	env->handles[slot] = escapee;
+	*result = escapee;
+	NAPI_MOCK_OK;
+}
+
+napi_status NAPI_CDECL napi_open_callback_scope(napi_env env, napi_value resource_object, napi_async_context context, napi_callback_scope* result) {
+	*result = (napi_callback_scope)env;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_close_callback_scope(napi_env env, napi_callback_scope scope)	{ NAPI_MOCK_OK; }
+napi_status NAPI_CDECL napi_async_init(napi_env env, napi_value async_resource, napi_value async_resource_name, napi_async_context* result) {
+	*result = (napi_async_context)env;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_async_destroy(napi_env env, napi_async_context async_context)	{ NAPI_MOCK_OK; }
+
+//	exceptions
+
+napi_status NAPI_CDECL napi_throw(napi_env env, napi_value error) {
+	NAPI_MOCK_CHECK(error, napi_invalid_arg);
+	hold(error);
+	release(exchange_exception(env, error));
+	NAPI_MOCK_OK;
+}
+static napi_status	throw_new(napi_env env, const char *code, const char *msg, const char *name) {
+	napi_value	c = nullptr;
+	if (code)
+		napi_create_string_utf8(env, code, NAPI_AUTO_LENGTH, &c);
+	napi_value	m;
+	napi_create_string_utf8(env, msg ? msg : "", NAPI_AUTO_LENGTH, &m);
+	return napi_throw(env, make_error(env, c, m, name));
+}
+napi_status NAPI_CDECL napi_throw_error(napi_env env, const char* code, const char* msg)		{ return throw_new(env, code, msg, "Error"); }
+napi_status NAPI_CDECL napi_throw_type_error(napi_env env, const char* code, const char* msg)	{ return throw_new(env, code, msg, "TypeError"); }
+napi_status NAPI_CDECL napi_throw_range_error(napi_env env, const char* code, const char* msg)	{ return throw_new(env, code, msg, "RangeError"); }
+#if NAPI_VERSION >= 9
+napi_status NAPI_CDECL node_api_throw_syntax_error(napi_env env, const char* code, const char* msg)	{ return throw_new(env, code, msg, "SyntaxError"); }
+#endif
+napi_status NAPI_CDECL napi_is_error(napi_env env, napi_value value, bool* result)	{ *result = value && value->kind == kind::error; NAPI_MOCK_OK; }
+napi_status NAPI_CDECL napi_is_exception_pending(napi_env env, bool* result)		{ *result = !!env->exception; NAPI_MOCK_OK; }
+napi_status NAPI_CDECL napi_get_and_clear_last_exception(napi_env env, napi_value* result) {
+	if (auto e = exchange_exception(env)) {
+		*result = handle(e);
+		release(e);
+	} else {
+		*result = &env->undefined_v;
+	}
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_fatal_exception(napi_env env, napi_value err)	{ return napi_throw(env, err); }
+NAPI_NO_RETURN void NAPI_CDECL napi_fatal_error(const char* location, size_t location_len, const char* message, size_t message_len) {
+	fprintf(stderr, "FATAL ERROR: %.*s %.*s\n", int(location_len == NAPI_AUTO_LENGTH ? strlen(location) : location_len), location, int(message_len == NAPI_AUTO_LENGTH ? strlen(message) : message_len), message);
+	abort();
+}
+
+//	binary data
+
+napi_status NAPI_CDECL napi_is_arraybuffer(napi_env env, napi_value value, bool* result)	{ *result = value && value->kind == kind::arraybuffer; NAPI_MOCK_OK; }
+napi_status NAPI_CDECL napi_create_arraybuffer(napi_env env, size_t byte_length, void** data, napi_value* result) {
+	auto	a = make_arraybuffer(new uint8_t[byte_length ? byte_length : 1](), byte_length, true);
+	if (data)
+		*data = a->bytes;
+	*result = a;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_create_external_arraybuffer(napi_env env, void* external_data, size_t byte_length, node_api_nogc_finalize finalize_cb, void* finalize_hint, napi_value* result) {
+	auto	a = make_arraybuffer((uint8_t*)external_data, byte_length, false);
+	if (finalize_cb)
+		a->finalizers.push_back({finalize_cb, external_data, finalize_hint});
+	*result = a;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_get_arraybuffer_info(napi_env env, napi_value arraybuffer, void** data, size_t* byte_length) {
+	NAPI_MOCK_CHECK(arraybuffer && arraybuffer->kind == kind::arraybuffer, napi_arraybuffer_expected);
+	if (data)
+		*data = arraybuffer->detached ? nullptr : arraybuffer->bytes;
+	if (byte_length)
+		*byte_length = arraybuffer->length;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_detach_arraybuffer(napi_env env, napi_value arraybuffer) {
+	NAPI_MOCK_CHECK(arraybuffer && arraybuffer->kind == kind::arraybuffer, napi_arraybuffer_expected);
+	arraybuffer->detached	= true;
+	arraybuffer->length		= 0;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_is_detached_arraybuffer(napi_env env, napi_value value, bool* result) {
+	*result = value && value->kind == kind::arraybuffer && value->detached;
+	NAPI_MOCK_OK;
+}
+
+napi_status NAPI_CDECL napi_is_typedarray(napi_env env, napi_value value, bool* result)	{ *result = value && value->kind == kind::typedarray; NAPI_MOCK_OK; }
+napi_status NAPI_CDECL napi_create_typedarray(napi_env env, napi_typedarray_type type, size_t length, napi_value arraybuffer, size_t byte_offset, napi_value* result) {
+	NAPI_MOCK_CHECK(arraybuffer && arraybuffer->kind == kind::arraybuffer, napi_invalid_arg);
+	auto	size = element_size(type);
+	NAPI_MOCK_CHECK(byte_offset % size == 0 && byte_offset + length * size <= arraybuffer->length, napi_invalid_arg);
+	*result = make_typedarray(type, length, arraybuffer, byte_offset);
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_get_typedarray_info(napi_env env, napi_value typedarray, napi_typedarray_type* type, size_t* length, void** data, napi_value* arraybuffer, size_t* byte_offset) {
+	NAPI_MOCK_CHECK(typedarray && typedarray->kind == kind::typedarray, napi_invalid_arg);
+	auto	b = typedarray->buffer;
+	if (type)
+		*type = typedarray->array_type;
+	if (length)
+		*length = b->detached ? 0 : typedarray->length;
+	if (data)
+		*data = b->detached ? nullptr : b->bytes + typedarray->offset;
+	if (arraybuffer)
+		*arraybuffer = handle(b);
+	if (byte_offset)
+		*byte_offset = typedarray->offset;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_create_dataview(napi_env env, size_t length, napi_value arraybuffer, size_t byte_offset, napi_value* result) {
+	NAPI_MOCK_CHECK(arraybuffer && arraybuffer->kind == kind::arraybuffer && byte_offset + length <= arraybuffer->length, napi_invalid_arg);
+	auto	v = make_typedarray(napi_uint8_array, length, arraybuffer, byte_offset);
+	v->kind = kind::dataview;
+	*result = v;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_is_dataview(napi_env env, napi_value value, bool* result)	{ *result = value && value->kind == kind::dataview; NAPI_MOCK_OK; }
+napi_status NAPI_CDECL napi_get_dataview_info(napi_env env, napi_value dataview, size_t* bytelength, void** data, napi_value* arraybuffer, size_t* byte_offset) {
+	NAPI_MOCK_CHECK(dataview && dataview->kind == kind::dataview, napi_invalid_arg);
+	auto	b = dataview->buffer;
+	if (bytelength)
+		*bytelength = b->detached ? 0 : dataview->length;
+	if (data)
+		*data = b->detached ? nullptr : b->bytes + dataview->offset;
+	if (arraybuffer)
+		*arraybuffer = handle(b);
+	if (byte_offset)
+		*byte_offset = dataview->offset;
+	NAPI_MOCK_OK;
+}
+
+//	Buffers are Uint8Arrays with a flag
+
+napi_status NAPI_CDECL napi_create_buffer(napi_env env, size_t length, void** data, napi_value* result) {
+	napi_value	ab;
+	napi_create_arraybuffer(env, length, data, &ab);
+	auto	b = make_typedarray(napi_uint8_array, length, ab, 0);
+	b->is_buffer = true;
+	*result = b;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_create_external_buffer(napi_env env, size_t length, void* data, node_api_nogc_finalize finalize_cb, void* finalize_hint, napi_value* result) {
+	napi_value	ab;
+	napi_create_external_arraybuffer(env, data, length, finalize_cb, finalize_hint, &ab);
+	auto	b = make_typedarray(napi_uint8_array, length, ab, 0);
+	b->is_buffer = true;
+	*result = b;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_create_buffer_copy(napi_env env, size_t length, const void* data, void** result_data, napi_value* result) {
+	void	*p;
+	napi_create_buffer(env, length, &p, result);
+	memcpy(p, data, length);
+	if (result_data)
+		*result_data = p;
+	NAPI_MOCK_OK;
+}
+#if NAPI_VERSION >= 10
+napi_status NAPI_CDECL node_api_create_buffer_from_arraybuffer(napi_env env, napi_value arraybuffer, size_t byte_offset, size_t byte_length, napi_value* result) {
+	NAPI_MOCK_CHECK(arraybuffer && arraybuffer->kind == kind::arraybuffer && byte_offset + byte_length <= arraybuffer->length, napi_invalid_arg);
+	auto	b = make_typedarray(napi_uint8_array, byte_length, arraybuffer, byte_offset);
+	b->is_buffer = true;
+	*result = b;
+	NAPI_MOCK_OK;
+}
+#endif
+napi_status NAPI_CDECL napi_is_buffer(napi_env env, napi_value value, bool* result) {
+	*result = value && value->kind == kind::typedarray && (value->is_buffer || value->array_type == napi_uint8_array);
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_get_buffer_info(napi_env env, napi_value value, void** data, size_t* length) {
+	NAPI_MOCK_CHECK(value && value->kind == kind::typedarray, napi_invalid_arg);
+	if (data)
+		*data = value->buffer->detached ? nullptr : value->buffer->bytes + value->offset;
+	if (length)
+		*length = value->buffer->detached ? 0 : value->length * element_size(value->array_type);
+	NAPI_MOCK_OK;
+}
+
+//	promises and dates
+
+napi_status NAPI_CDECL napi_create_promise(napi_env env, napi_deferred* deferred, napi_value* promise) {
+	auto	p = make(napi_object, kind::promise);
+	hold(p);	// released when the deferred is settled
+	*deferred	= (napi_deferred)p;
+	*promise	= p;
+	NAPI_MOCK_OK;
+}
+static napi_status	settle(napi_env env, napi_deferred deferred, napi_value v, int state) {
+	auto	p = (napi_value)deferred;
+	NAPI_MOCK_CHECK(p && p->state == 0, napi_invalid_arg);
+	p->state	= state;
+	p->result	= v;
+	hold(v);
+	release(p);
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_resolve_deferred(napi_env env, napi_deferred deferred, napi_value resolution)	{ return settle(env, deferred, resolution, 1); }
+napi_status NAPI_CDECL napi_reject_deferred(napi_env env, napi_deferred deferred, napi_value rejection)		{ return settle(env, deferred, rejection, 2); }
+napi_status NAPI_CDECL napi_is_promise(napi_env env, napi_value value, bool* is_promise)	{ *is_promise = value && value->kind == kind::promise; NAPI_MOCK_OK; }
+
+napi_status NAPI_CDECL napi_create_date(napi_env env, double time, napi_value* result) {
+	auto	d = make(napi_object, kind::date);
+	d->d = time;
+	*result = d;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_is_date(napi_env env, napi_value value, bool* is_date)	{ *is_date = value && value->kind == kind::date; NAPI_MOCK_OK; }
+napi_status NAPI_CDECL napi_get_date_value(napi_env env, napi_value value, double* result) {
+	NAPI_MOCK_CHECK(value && value->kind == kind::date, napi_date_expected);
+	*result = value->d;
+	NAPI_MOCK_OK;
+}
+
+//	bigints, as sign and magnitude
+
+napi_status NAPI_CDECL napi_create_bigint_words(napi_env env, int sign_bit, size_t word_count, const uint64_t* words, napi_value* result) {
+	auto	v = make(napi_bigint);
+	v->words.assign(words, words + word_count);
+	while (!v->words.empty() && !v->words.back())
+		v->words.pop_back();
+	v->b = sign_bit && !v->words.empty();
+	*result = v;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_create_bigint_int64(napi_env env, int64_t value, napi_value* result) {
+	uint64_t	w = value < 0 ? 0 - uint64_t(value) : uint64_t(value);
+	return napi_create_bigint_words(env, value < 0, 1, &w, result);
+}
+napi_status NAPI_CDECL napi_create_bigint_uint64(napi_env env, uint64_t value, napi_value* result) {
+	return napi_create_bigint_words(env, 0, 1, &value, result);
+}
+napi_status NAPI_CDECL napi_get_value_bigint_int64(napi_env env, napi_value value, int64_t* result, bool* lossless) {
+	NAPI_MOCK_CHECK(value && value->type == napi_bigint, napi_bigint_expected);
+	uint64_t	w = value->words.empty() ? 0 : value->words[0];
+	*result		= int64_t(value->b ? 0 - w : w);
+	*lossless	= value->words.size() <= 1 && (value->b ? w <= uint64_t(1) << 63 : w < uint64_t(1) << 63);
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_get_value_bigint_uint64(napi_env env, napi_value value, uint64_t* result, bool* lossless) {
+	NAPI_MOCK_CHECK(value && value->type == napi_bigint, napi_bigint_expected);
+	uint64_t	w = value->words.empty() ? 0 : value->words[0];
+	*result		= value->b ? 0 - w : w;
+	*lossless	= value->words.size() <= 1 && !value->b;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_get_value_bigint_words(napi_env env, napi_value value, int* sign_bit, size_t* word_count, uint64_t* words) {
+	NAPI_MOCK_CHECK(value && value->type == napi_bigint, napi_bigint_expected);
+	if (words) {
+		auto	n = std::min(*word_count, value->words.size());
+		std::copy(value->words.begin(), value->words.begin() + n, words);
+		*word_count = n;
+		if (sign_bit)
+			*sign_bit = value->b;
+	} else {
+		*word_count = value->words.size();
+	}
+	NAPI_MOCK_OK;
+}
+
+//	everything else
+
+napi_status NAPI_CDECL napi_run_script(napi_env env, napi_value script, napi_value* result) {
+	return status(env, napi_cannot_run_js);
+}
+napi_status NAPI_CDECL napi_get_version(node_api_nogc_env env, uint32_t* result) {
+	*result = NAPI_VERSION > 10 ? 10 : NAPI_VERSION;
+	return status((napi_env)env, napi_ok);
+}
+napi_status NAPI_CDECL napi_get_node_version(node_api_nogc_env env, const napi_node_version** version) {
+	static const napi_node_version	v = {0, 0, 0, "mock"};
+	*version = &v;
+	return status((napi_env)env, napi_ok);
+}
+napi_status NAPI_CDECL napi_adjust_external_memory(node_api_nogc_env env, int64_t change_in_bytes, int64_t* adjusted_value) {
+	auto	e = (napi_env)env;
+	e->external_memory += change_in_bytes;
+	if (adjusted_value)
+		*adjusted_value = e->external_memory;
+	return status(e, napi_ok);
+}
+
+napi_status NAPI_CDECL napi_add_finalizer(napi_env env, napi_value js_object, void* finalize_data, node_api_nogc_finalize finalize_cb, void* finalize_hint, napi_ref* result) {
+	NAPI_MOCK_CHECK(is_object(js_object) && finalize_cb, napi_invalid_arg);
+	js_object->finalizers.push_back({finalize_cb, finalize_data, finalize_hint});
+	if (result)
+		napi_create_reference(env, js_object, 0, result);
+	NAPI_MOCK_OK;
+}
+
+napi_status NAPI_CDECL napi_set_instance_data(node_api_nogc_env env, void* data, napi_finalize finalize_cb, void* finalize_hint) {
+	auto	e = (napi_env)env;
+	e->instance_data	= data;
+	e->instance_fin		= finalize_cb;
+	e->instance_hint	= finalize_hint;
+	return status(e, napi_ok);
+}
+napi_status NAPI_CDECL napi_get_instance_data(node_api_nogc_env env, void** data) {
+	auto	e = (napi_env)env;
+	*data = e->instance_data;
+	return status(e, napi_ok);
+}
+
+napi_status NAPI_CDECL napi_type_tag_object(napi_env env, napi_value value, const napi_type_tag* type_tag) {
+	NAPI_MOCK_CHECK(is_object(value) && !value->tagged, napi_invalid_arg);
+	value->tagged	= true;
+	value->tag		= *type_tag;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_check_object_type_tag(napi_env env, napi_value value, const napi_type_tag* type_tag, bool* result) {
+	NAPI_MOCK_CHECK(is_object(value), napi_object_expected);
+	*result = value->tagged && value->tag.lower == type_tag->lower && value->tag.upper == type_tag->upper;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_object_freeze(napi_env env, napi_value object)	{ NAPI_MOCK_OK; }
+napi_status NAPI_CDECL napi_object_seal(napi_env env, napi_value object)	{ NAPI_MOCK_OK; }
+
+void NAPI_CDECL napi_module_register(napi_module* mod)	{}
+
+napi_status NAPI_CDECL napi_add_env_cleanup_hook(node_api_nogc_env env, napi_cleanup_hook fun, void* arg) {
+	auto	e = (napi_env)env;
+	e->cleanup.emplace_back(fun, arg);
+	return status(e, napi_ok);
+}
+napi_status NAPI_CDECL napi_remove_env_cleanup_hook(node_api_nogc_env env, napi_cleanup_hook fun, void* arg) {
+	auto	e = (napi_env)env;
+	for (auto i = e->cleanup.begin(); i != e->cleanup.end(); ++i) {
+		if (i->first == fun && i->second == arg) {
+			e->cleanup.erase(i);
+			break;
+		}
+	}
+	return status(e, napi_ok);
+}
+
+//	async work and threadsafe functions queue until napi_mock::run_async()
+
+napi_status NAPI_CDECL napi_create_async_work(napi_env env, napi_value async_resource, napi_value async_resource_name, napi_async_execute_callback execute, napi_async_complete_callback complete, void* data, napi_async_work* result) {
+	NAPI_MOCK_CHECK(execute && complete, napi_invalid_arg);
+	*result = new napi_async_work__{execute, complete, data};
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_delete_async_work(napi_env env, napi_async_work work) {
+	delete work;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_queue_async_work(node_api_nogc_env env, napi_async_work work) {
+	auto	e = (napi_env)env;
+	std::lock_guard<std::mutex>	lock(e->queue_mutex);
+	work->queued = true;
+	e->work.push_back(work);
+	return status(e, napi_ok);
+}
+napi_status NAPI_CDECL napi_cancel_async_work(node_api_nogc_env env, napi_async_work work) {
+	auto	e = (napi_env)env;
+	std::lock_guard<std::mutex>	lock(e->queue_mutex);
+	if (!work->queued)
+		return status(e, napi_generic_failure);
+	work->cancelled = true;
+	return status(e, napi_ok);
+}
+
+napi_status NAPI_CDECL napi_create_threadsafe_function(napi_env env, napi_value func, napi_value async_resource, napi_value async_resource_name, size_t max_queue_size, size_t initial_thread_count, void* thread_finalize_data, napi_finalize thread_finalize_cb, void* context, napi_threadsafe_function_call_js call_js_cb, napi_threadsafe_function* result) {
+	NAPI_MOCK_CHECK(func || call_js_cb, napi_invalid_arg);
+	auto	f = new napi_threadsafe_function__{call_js_cb, func, context, thread_finalize_cb, thread_finalize_data, initial_thread_count};
+	hold(func);
+	std::lock_guard<std::mutex>	lock(env->queue_mutex);
+	env->tsfns.push_back(f);
+	*result = f;
+	NAPI_MOCK_OK;
+}
+napi_status NAPI_CDECL napi_get_threadsafe_function_context(napi_threadsafe_function func, void** result) {
+	*result = func->context;
+	return napi_ok;
+}
+napi_status NAPI_CDECL napi_call_threadsafe_function(napi_threadsafe_function func, void* data, napi_threadsafe_function_call_mode is_blocking) {
+	auto	env = host();
+	std::lock_guard<std::mutex>	lock(env->queue_mutex);
+	if (func->closing)
+		return napi_closing;
+	func->calls.push_back(data);
+	return napi_ok;
+}
+napi_status NAPI_CDECL napi_acquire_threadsafe_function(napi_threadsafe_function func) {
+	std::lock_guard<std::mutex>	lock(host()->queue_mutex);
+	if (func->closing)
+		return napi_closing;
+	++func->threads;
+	return napi_ok;
+}
+napi_status NAPI_CDECL napi_release_threadsafe_function(napi_threadsafe_function func, napi_threadsafe_function_release_mode mode) {
+	std::lock_guard<std::mutex>	lock(host()->queue_mutex);
+	if (func->threads)
+		--func->threads;
+	if (mode == napi_tsfn_abort) {
+		func->closing = true;
+		func->calls.clear();
+	}
+	return napi_ok;
+}
+napi_status NAPI_CDECL napi_unref_threadsafe_function(node_api_nogc_env env, napi_threadsafe_function func)	{ return napi_ok; }
+napi_status NAPI_CDECL napi_ref_threadsafe_function(node_api_nogc_env env, napi_threadsafe_function func)	{ return napi_ok; }
+
+} // extern "C"
+
+#undef NAPI_MOCK_CHECK
+#undef NAPI_MOCK_OK
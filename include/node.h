@@ -1,9 +1,28 @@
+#pragma once
 #include "base.h"
 #include <node_api.h>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <mutex>
+#include <deque>
+#include <tuple>
+#include <climits>
+#include <cstdio>
+#if defined(NODE_TRACE) && (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
+#define NODE_TRACE_TSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
 
 template<auto F, typename = decltype(F)> struct field {
 	const char *name;
-	inline field(const char *name) : name(name) {}
+	constexpr field(const char *name) : name(name) {}
 };
 
 namespace Node {
@@ -17,7 +36,8 @@ struct any_pointer {
 struct finalizer {
 	node_api_nogc_finalize cb;
 	void* hint;
-	template<typename L> finalizer(L &&lambda) {
+	finalizer(node_api_nogc_finalize cb, void *hint) : cb(cb), hint(hint) {}
+	template<typename L, enable_if_t<!std::is_same_v<std::decay_t<L>, finalizer>>* = nullptr> finalizer(L &&lambda) {
 		hint	= &lambda;
 		cb	    = [](napi_env, void *data, void* hint) { (*(L*)hint)(any_pointer(data)); };
 	}
@@ -29,6 +49,236 @@ struct string_param {
 	string_param(const char* utf8, size_t length = NAPI_AUTO_LENGTH) : utf8(utf8), length(length) {}
 };
 
+// readable name of a type, from the compiler; Node:: namespaces and address-of signs are dropped
+template<typename K> const char* type_name() {
+	static char	name[128];
+	if (!name[0]) {
+	#ifdef _MSC_VER
+		const char	*s = strstr(__FUNCSIG__, "type_name<") + 10;
+		const char	*e = strrchr(s, '>');
+	#else
+		const char	*s = strstr(__PRETTY_FUNCTION__, "K = ") + 4;
+		const char	*e = s + strcspn(s, ";]");
+	#endif
+		size_t	n = 0;
+		while (s < e && n < sizeof(name) - 1) {
+			if (strncmp(s, "Node::", 6) == 0)
+				s += 6;
+			else if (strncmp(s, "metrics::", 9) == 0)
+				s += 9;
+			else if (strncmp(s, "trace::", 7) == 0)
+				s += 7;
+			else if (*s == '&')
+				++s;
+			else
+				name[n++] = *s++;
+		}
+		name[n] = 0;
+	}
+	return name;
+}
+
+//-----------------------------------------------------------------------------
+//	trace - counts and times every checked N-API call (everything through environment::api), per binding
+//	define NODE_TRACE to enable; the last trace::capacity calls are also kept as chrome trace events
+//-----------------------------------------------------------------------------
+
+namespace trace {
+#ifdef NODE_TRACE
+static constexpr bool	enabled	= true;
+#else
+static constexpr bool	enabled	= false;
+#endif
+
+template<auto F> struct api {};
+
+inline uint64_t	ticks() {
+#ifdef NODE_TRACE_TSC
+	return __rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// ticks per microsecond, measured against steady_clock since the first call
+inline double	ticks_per_us() {
+	typedef std::chrono::steady_clock	clock;
+	static auto		c0 = clock::now();
+	static uint64_t	t0 = ticks();
+	double	us	= std::chrono::duration<double, std::micro>(clock::now() - c0).count();
+	return us > 1000 ? (ticks() - t0) / us : 1;
+}
+
+struct entry {
+	const char	*api, *binding;
+	uint64_t	calls, ticks;
+};
+struct event {
+	const char	*name;
+	uint64_t	start, ticks;
+	bool		is_binding;
+};
+
+inline const char			invocations[] = "(invocations)";	// api name used to count the binding's own calls
+static constexpr uint32_t	table_size	= 1024;		// distinct (api, binding) pairs per thread
+inline uint32_t				capacity	= 1 << 16;	// events kept per thread; read as each thread's recorder is created
+
+// one per thread; only its own thread writes, so dumps are only exact while nothing is running
+struct recorder {
+	const char	*binding	= "(native)";
+	entry		table[table_size] = {};
+	uint32_t	capacity	= trace::capacity;	// fixed per recorder, so a later change cannot index past its events
+	event		*events;
+	uint64_t	num_events	= 0;
+	uint32_t	tid;
+	recorder	*next;
+
+	static std::atomic<recorder*>&	all()	{ static std::atomic<recorder*> head{nullptr}; return head; }
+	static recorder&	local()	{ static thread_local recorder *r = new recorder; return *r; }
+
+	recorder() : events(new event[capacity]) {
+		ticks_per_us();		// starts the calibration
+		static std::atomic<uint32_t>	threads{0};
+		tid		= ++threads;
+		next	= all().load();
+		while (!all().compare_exchange_weak(next, this))
+			;
+	}
+
+	void	record(const char *name, uint64_t start, uint64_t t, bool is_binding) {
+		events[num_events++ % capacity] = {name, start, t, is_binding};
+	}
+	void	count(const char *api, uint64_t start, uint64_t t) {
+		tally(api, t);
+		record(api, start, t, false);
+	}
+	void	tally(const char *api, uint64_t t) {
+		auto	h = ((uintptr_t(api) >> 4) * 31 + (uintptr_t(binding) >> 4)) % table_size;
+		for (uint32_t i = 0; i < table_size; i++, h = (h + 1) % table_size) {
+			auto	&e = table[h];
+			if (e.api == api && e.binding == binding) {
+				e.calls++;
+				e.ticks += t;
+				break;
+			}
+			if (!e.api) {
+				e = {api, binding, 1, t};
+				break;
+			}
+		}
+	}
+	void	clear() {
+		for (auto &e : table)
+			e = {};
+		num_events = 0;
+	}
+};
+
+template<auto F> const char* api_name() {
+	static char	name[128];
+	if (!name[0]) {
+		auto	s = type_name<api<F>>() + 4;		// api<...>
+		size_t	n = min(strlen(s) - 1, sizeof(name) - 1);
+		memcpy(name, s, n);
+		name[n] = 0;
+	}
+	return name;
+}
+
+// times one N-API call
+template<auto F> struct call {
+	uint64_t	t0 = ticks();
+	~call() {
+		auto	t = ticks() - t0;
+		recorder::local().count(api_name<F>(), t0, t);
+	}
+};
+
+// marks the binding running on this thread, so api calls are attributed to it
+struct binding {
+	const char	*prev;
+	uint64_t	t0;
+	binding(const char *name) : prev(exchange(recorder::local().binding, name)), t0(ticks()) {}
+	~binding() {
+		auto	&r = recorder::local();
+		auto	t = ticks() - t0;
+		r.tally(invocations, t);
+		r.record(r.binding, t0, t, true);
+		r.binding = prev;
+	}
+};
+
+inline void	reset() {
+	for (auto r = recorder::all().load(); r; r = r->next)
+		r->clear();
+}
+
+// one line per (api, binding) pair, most expensive first, with the average number of calls per invocation of the binding
+inline std::string	summary() {
+	std::vector<entry>	all;
+	for (auto r = recorder::all().load(); r; r = r->next) {
+		for (auto &e : r->table) {
+			if (!e.api)
+				continue;
+			bool	merged = false;
+			for (auto &i : all) {
+				if (i.api == e.api && i.binding == e.binding) {
+					i.calls += e.calls;
+					i.ticks += e.ticks;
+					merged = true;
+				}
+			}
+			if (!merged)
+				all.push_back(e);
+		}
+	}
+	for (size_t i = 1; i < all.size(); i++)
+		for (size_t j = i; j > 0 && all[j - 1].ticks < all[j].ticks; j--)
+			swap(all[j - 1], all[j]);
+
+	double		scale = ticks_per_us();
+	std::string	r;
+	char		line[256];
+	snprintf(line, sizeof(line), "%-40s %-40s %12s %12s %10s %10s\n", "api", "binding", "calls", "total us", "us/call", "per inv");
+	r += line;
+	for (auto &e : all) {
+		uint64_t	inv = 0;
+		for (auto &i : all)
+			if (i.api == invocations && i.binding == e.binding)
+				inv = i.calls;
+		snprintf(line, sizeof(line), "%-40s %-40s %12llu %12.1f %10.3f %10.2f\n", e.api, e.binding, (unsigned long long)e.calls, e.ticks / scale, e.ticks / scale / e.calls, inv ? double(e.calls) / inv : 0.);
+		r += line;
+	}
+	return r;
+}
+
+// chrome://tracing / perfetto JSON of the kept events: bindings and the api calls inside them
+inline std::string	chrome_json() {
+	double		scale	= ticks_per_us();
+	uint64_t	origin	= ~uint64_t(0);
+	for (auto r = recorder::all().load(); r; r = r->next) {
+		for (uint64_t i = r->num_events > r->capacity ? r->num_events - r->capacity : 0; i < r->num_events; i++)
+			origin = min(origin, r->events[i % r->capacity].start);
+	}
+
+	std::string	s	= "{\"traceEvents\":[";
+	char		line[384];
+	bool		first = true;
+	for (auto r = recorder::all().load(); r; r = r->next) {
+		for (uint64_t i = r->num_events > r->capacity ? r->num_events - r->capacity : 0; i < r->num_events; i++) {
+			auto	&e = r->events[i % r->capacity];
+			snprintf(line, sizeof(line), "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+				first ? "" : ",", e.name, e.is_binding ? "binding" : "napi", (e.start - origin) / scale, e.ticks / scale, r->tid
+			);
+			s += line;
+			first = false;
+		}
+	}
+	return s + "\n]}\n";
+}
+
+} // namespace trace
+
 //-----------------------------------------------------------------------------
 //	environment
 //-----------------------------------------------------------------------------
@@ -45,12 +295,20 @@ struct environment {
 		api_call(environment *env) : env(env) {}
 		auto operator()(A...a) {
 			remove_const_t<deref_t<B>>	result;
-			return env->checked(F(env->env, a..., &result), result);
+			return env->checked(traced(a..., &result), result);
 		}
 		void operator()(A...a, B result) {
-			if (!env->check(F(env->env, a..., result)))
+			if (!env->check(traced(a..., result)))
 				*result = nullptr;
 		}
+		napi_status traced(A...a, B result) {
+			if constexpr (trace::enabled) {
+				trace::call<F>	t;
+				return F(env->env, a..., result);
+			} else {
+				return F(env->env, a..., result);
+			}
+		}
 	};
 	template<auto F, typename T = decltype(F)> struct api_helper;
 	template<auto F, typename...A> struct api_helper<F, napi_status(*)(A...)> : api_call<F, except_last_t<tail_t<A...>>, last_t<A...>> {
@@ -88,16 +346,281 @@ struct environment {
 	value 	run_script(string script);
 };
 
-static environment global_env(nullptr);
+// each worker_thread that loads the addon gets its own env (and isolate), so with NODE_WORKER_THREADS the current env
+// and the few napi_values and references cached in statics are kept per thread; without it they are process-wide and cheaper
+#ifndef NODE_WORKER_THREADS
+#define NODE_WORKER_THREADS	0
+#endif
+#if NODE_WORKER_THREADS
+#define NODE_PER_ENV	thread_local
+#else
+#define NODE_PER_ENV
+#endif
+
+static NODE_PER_ENV environment global_env(nullptr);
+
+//-----------------------------------------------------------------------------
+//	leak counts - references, handle scopes and wrapped instances currently owned by this library
+//	define NODE_LEAK_COUNTS as 1 to enable; the counts are shared atomics, so they stay off unless asked for, even in debug builds
+//	it changes inline functions throughout this header, so it must be set the same way for every file of the addon (on the compiler command line, not before one include)
+//	a binding that leaves any of these higher after it returns (and a GC has run) is leaking
+//-----------------------------------------------------------------------------
+
+#ifndef NODE_LEAK_COUNTS
+#define NODE_LEAK_COUNTS	0
+#endif
+
+namespace leaks {
+static constexpr bool enabled = NODE_LEAK_COUNTS;
+
+enum kind { refs, scopes, wrapped, num_kinds };
+
+inline std::atomic<int64_t>*	counts()	{ static std::atomic<int64_t> c[num_kinds]; return c; }
+inline void		add(kind k, int64_t n)		{ if constexpr (enabled) counts()[k].fetch_add(n, std::memory_order_relaxed); }
+inline int64_t	get(kind k)					{ return counts()[k].load(std::memory_order_relaxed); }
+} // namespace leaks
+
+//-----------------------------------------------------------------------------
+//	scopes
+//-----------------------------------------------------------------------------
+
+class scope {
+	napi_handle_scope	v;
+public:
+	scope()		{ global_env.api<napi_open_handle_scope>()(&v); leaks::add(leaks::scopes, 1); }
+	~scope()	{ napi_close_handle_scope(global_env, v); leaks::add(leaks::scopes, -1); }
+};
+
+class escapable_scope {
+	napi_escapable_handle_scope	v;
+public:
+	escapable_scope()	{ global_env.api<napi_open_escapable_handle_scope>()(&v); leaks::add(leaks::scopes, 1); }
+	~escapable_scope()	{ napi_close_escapable_handle_scope(global_env, v); leaks::add(leaks::scopes, -1); }
+
+	napi_value escape(napi_value escapee) {
+		return global_env.api<napi_escape_handle>()(v, escapee);
+	}
+};
+
+class callback_scope {
+	napi_callback_scope v;
+public:
+	callback_scope(napi_async_context context, napi_value async_resource)	{
+        global_env.api<napi_open_callback_scope>()(async_resource, context, &v);
+    }
+	~callback_scope()	{ napi_close_callback_scope(global_env, v); }
+};
+
+// closes and reopens a handle scope every chunk calls to next(), so a long loop only keeps one chunk's worth of handles alive
+// next(keep) escapes keep into the enclosing scope when the chunk turns over (one value per chunk, eg. an accumulator)
+class chunked_scope {
+	napi_escapable_handle_scope	v = nullptr;
+	uint32_t	chunk, i = 0;
+
+	void	open()	{ global_env.api<napi_open_escapable_handle_scope>()(&v); leaks::add(leaks::scopes, 1); }
+public:
+	static constexpr uint32_t default_chunk = 256;
+
+	chunked_scope(uint32_t chunk = default_chunk) : chunk(chunk) { open(); }
+	~chunked_scope()	{ close(); }
+
+	void	close()	{
+		if (v) {
+			napi_close_escapable_handle_scope(global_env, exchange(v, nullptr));
+			leaks::add(leaks::scopes, -1);
+		}
+	}
+	void	close(napi_value &keep)	{
+		if (v && keep)
+			keep = global_env.api<napi_escape_handle>()(v, keep);
+		close();
+	}
+	void	next() {
+		if (++i == chunk) {
+			i = 0;
+			close();
+			open();
+		}
+	}
+	void	next(napi_value &keep) {
+		if (++i == chunk) {
+			i = 0;
+			close(keep);
+			open();
+		}
+	}
+};
+
+//-----------------------------------------------------------------------------
+//	metrics - call counts, time and latency histograms per binding
+//	define NODE_METRICS to instrument every trampoline, or specialise metered<F> to pick single bindings
+//	each thread writes its own counters (relaxed, single writer), and reads merge them
+//-----------------------------------------------------------------------------
+
+namespace metrics {
+#ifdef NODE_METRICS
+static constexpr bool	enabled	= true;
+#else
+static constexpr bool	enabled	= false;
+#endif
+static constexpr int	buckets	= 32;	// bucket 0: < 256ns, bucket i: [2^(i+7), 2^(i+8)) ns, the last is open ended
+
+template<auto F> struct fn {};
+template<auto F> struct get {};
+template<auto F> struct set {};
+template<typename C, typename...A> struct construct {};
+
+inline uint64_t	now() { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+
+inline int	bucket(uint64_t ns) {
+	int	b = 0;
+	for (ns >>= 8; ns && b < buckets - 1; ns >>= 1)
+		++b;
+	return b;
+}
+
+struct totals {
+	uint64_t	calls = 0, total = 0, max = 0, slow = 0;
+	uint64_t	hist[buckets] = {};
+};
+
+struct counters {
+	std::atomic<uint64_t>	calls{0}, total{0}, max{0}, slow{0};
+	std::atomic<uint64_t>	hist[buckets] = {};
+	counters	*next = nullptr;
+
+	static void	add(std::atomic<uint64_t> &c, uint64_t n)	{ c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+	void	record(uint64_t ns, bool over) {
+		add(calls, 1);
+		add(total, ns);
+		add(hist[bucket(ns)], 1);
+		if (ns > max.load(std::memory_order_relaxed))
+			max.store(ns, std::memory_order_relaxed);
+		if (over)
+			add(slow, 1);
+	}
+};
+
+// the watchdog: synchronous calls over budget ns are counted as slow and reported (0 disables it)
+inline std::atomic<uint64_t>&	budget()	{ static std::atomic<uint64_t> ns{0}; return ns; }
+typedef void	report_t(const char *name, uint64_t ns);
+inline std::atomic<report_t*>&	reporter()	{
+	static std::atomic<report_t*>	r{[](const char *name, uint64_t ns) { fprintf(stderr, "slow binding %s: %.3fms\n", name, ns / 1e6); }};
+	return r;
+}
+
+class site {
+	std::atomic<counters*>	shards{nullptr};
+public:
+	const char	*name;
+	site		*next;
+
+	static std::atomic<site*>&	all()	{ static std::atomic<site*> head{nullptr}; return head; }
+
+	site(const char *name) : name(name) {
+		next = all().load();
+		while (!all().compare_exchange_weak(next, this))
+			;
+	}
+
+	counters*	add_shard() {
+		auto	c = new counters;
+		c->next = shards.load();
+		while (!shards.compare_exchange_weak(c->next, c))
+			;
+		return c;
+	}
+	totals	read() const {
+		totals	t;
+		for (auto c = shards.load(); c; c = c->next) {
+			t.calls	+= c->calls.load(std::memory_order_relaxed);
+			t.total	+= c->total.load(std::memory_order_relaxed);
+			t.slow	+= c->slow.load(std::memory_order_relaxed);
+			t.max	= ::max(t.max, c->max.load(std::memory_order_relaxed));
+			for (int i = 0; i < buckets; i++)
+				t.hist[i] += c->hist[i].load(std::memory_order_relaxed);
+		}
+		return t;
+	}
+	// only exact when no other thread is recording
+	void	reset() {
+		for (auto c = shards.load(); c; c = c->next) {
+			c->calls = c->total = c->max = c->slow = 0;
+			for (auto &h : c->hist)
+				h = 0;
+		}
+	}
+};
+
+template<typename K> struct site_of {
+	static site&	get()	{ static site s(type_name<K>()); return s; }
+	static counters&	local()	{ static thread_local counters *c = get().add_shard(); return *c; }
+};
+
+template<typename K> struct timer {
+	uint64_t	t0 = now();
+	~timer() {
+		uint64_t	ns		= now() - t0;
+		uint64_t	limit	= budget().load(std::memory_order_relaxed);
+		bool		over	= limit && ns > limit;
+		site_of<K>::local().record(ns, over);
+		if (over)
+			if (auto r = reporter().load())
+				r(site_of<K>::get().name, ns);
+	}
+};
+
+// also marks the binding as the current one for trace
+template<bool ON, typename K, typename G> napi_value measure(G &&g) {
+	if constexpr (ON && trace::enabled) {
+		trace::binding	b(site_of<K>::get().name);
+		timer<K>		t;
+		return g();
+	} else if constexpr (ON) {
+		timer<K>		t;
+		return g();
+	} else if constexpr (trace::enabled) {
+		trace::binding	b(type_name<K>());
+		return g();
+	} else {
+		return g();
+	}
+}
+
+} // namespace metrics
+
+template<auto F> constexpr bool metered = metrics::enabled;
 
 //-----------------------------------------------------------------------------
 //	callbacks
 //-----------------------------------------------------------------------------
 
+// used by the trampolines, and defined further down
+template<typename T> auto	to_value(T &&x);
+template<typename T> auto	from_value(napi_value x);
+template<typename T> class	wrapped;
+template<typename T> struct	Class;
+template<typename T> struct shared_layout;
+extern struct _undefined	undefined;
+
+// specialise to true for allocation-heavy bindings: the trampoline then runs them in their own scope and escapes only the result
+template<auto F> constexpr bool auto_scope = false;
+
 struct callback {
 	napi_callback	cb;
 	void			*data;
 
+	template<auto F, typename G> static napi_value scoped(G &&g) {
+		return metrics::measure<metered<F>, metrics::fn<F>>([&] {
+			if constexpr (auto_scope<F>) {
+				escapable_scope	s;
+				return s.escape(g());
+			} else {
+				return g();
+			}
+		});
+	}
+
 	template<typename I, typename F> struct helper2;
 	
 	template<size_t...I, typename R, typename...A> struct helper2<std::index_sequence<I...>, R (*)(A...)> {
@@ -107,7 +630,7 @@ struct callback {
 			napi_value	this_arg;
 			void*		data;
 			napi_get_cb_info(env, info, &argc, argv, &this_arg, &data);
-			return save(global_env.env, env), to_value(F(from_value<A>(argv[I])...));
+			return save(global_env.env, env), scoped<F>([&] { return to_value(F(from_value<A>(argv[I])...)); });
 		}
 		template<typename L> static napi_value lambda(napi_env env, napi_callback_info info) {
 			size_t		argc = sizeof...(I);
@@ -115,7 +638,7 @@ struct callback {
 			napi_value	this_arg;
 			void*		data;
 			napi_get_cb_info(env, info, &argc, argv, &this_arg, &data);
-			return save(global_env.env, env), to_value((*(L*)data)(from_value<A>(argv[I])...));
+			return save(global_env.env, env), metrics::measure<metrics::enabled, L>([&] { return to_value((*(L*)data)(from_value<A>(argv[I])...)); });
 		}
 	};
 
@@ -127,7 +650,7 @@ struct callback {
 			napi_value	this_arg;
 			void*		data;
 			napi_get_cb_info(env, info, &argc, argv, &this_arg, &data);
-			return save(global_env.env, env), F(from_value<A>(argv[I])...), undefined;
+			return save(global_env.env, env), scoped<F>([&]() -> napi_value { return F(from_value<A>(argv[I])...), undefined; });
 		}
 		template<typename L> static napi_value lambda(napi_env env, napi_callback_info info) {
 			size_t		argc = sizeof...(I);
@@ -135,7 +658,7 @@ struct callback {
 			napi_value	this_arg;
 			void*		data;
 			napi_get_cb_info(env, info, &argc, argv, &this_arg, &data);
-			return save(global_env.env, env), (*(L*)data)(from_value<A>(argv[I])...), undefined;
+			return save(global_env.env, env), metrics::measure<metrics::enabled, L>([&]() -> napi_value { return (*(L*)data)(from_value<A>(argv[I])...), undefined; });
 		}
 	};
 
@@ -147,7 +670,7 @@ struct callback {
 			void*		data;
 			napi_get_cb_info(env, info, &argc, argv, &this_arg, &data);
 			auto &c = *wrapped<C>(this_arg);
-			return save(global_env.env, env), to_value((c.*F)(from_value<A>(argv[I])...));
+			return save(global_env.env, env), scoped<F>([&] { return to_value((c.*F)(from_value<A>(argv[I])...)); });
 		}
         template<typename L> static napi_value lambda(napi_env env, napi_callback_info info) {
 			size_t		argc = sizeof...(I);
@@ -155,7 +678,7 @@ struct callback {
 			napi_value	this_arg;
 			void*		data;
 			napi_get_cb_info(env, info, &argc, argv, &this_arg, &data);
-			return save(global_env.env, env), to_value((*(L*)data)(from_value<A>(argv[I])...));
+			return save(global_env.env, env), metrics::measure<metrics::enabled, L>([&] { return to_value((*(L*)data)(from_value<A>(argv[I])...)); });
 		}
 	};
 
@@ -167,7 +690,7 @@ struct callback {
 			void*		data;
 			napi_get_cb_info(env, info, &argc, argv, &this_arg, &data);
 			auto &c = *wrapped<C>(this_arg);
-			return save(global_env.env, env), (c.*F)(from_value<A>(argv[I])...), undefined;
+			return save(global_env.env, env), scoped<F>([&]() -> napi_value { return (c.*F)(from_value<A>(argv[I])...), undefined; });
 		}
         template<typename L> static napi_value lambda(napi_env env, napi_callback_info info) {
 			size_t		argc = sizeof...(I);
@@ -175,7 +698,7 @@ struct callback {
 			napi_value	this_arg;
 			void*		data;
 			napi_get_cb_info(env, info, &argc, argv, &this_arg, &data);
-			return save(global_env.env, env), (*(L*)data)(from_value<A>(argv[I])...), undefined;
+			return save(global_env.env, env), metrics::measure<metrics::enabled, L>([&]() -> napi_value { return (*(L*)data)(from_value<A>(argv[I])...), undefined; });
 		}
 	};
 
@@ -187,8 +710,21 @@ struct callback {
 			napi_value	this_arg;
 			void*		data;
 			napi_get_cb_info(env, info, &argc, argv, &this_arg, &data);
-			wrapped<C>(this_arg, new C(from_value<A>(argv[I])...));
-			return this_arg;
+			return metrics::measure<metrics::enabled, metrics::construct<C, A...>>([&] {
+				wrapped<C>(this_arg, new C(from_value<A>(argv[I])...));
+				return this_arg;
+			});
+		}
+		// the native object is placed inside an ArrayBuffer whose fields JS reads directly (see shared_layout)
+		static napi_value shared(napi_env env, napi_callback_info info) {
+			size_t		argc = sizeof...(I);
+			napi_value	argv[sizeof...(I)];
+			napi_value	this_arg;
+			void*		data;
+			napi_get_cb_info(env, info, &argc, argv, &this_arg, &data);
+			return metrics::measure<metrics::enabled, metrics::construct<C, A...>>([&] {
+				return shared_layout<C>::construct(this_arg, [&](void *p) { return new(p) C(from_value<A>(argv[I])...); });
+			});
 		}
 	};
 
@@ -201,6 +737,7 @@ struct callback {
 	template<typename L> static auto make(L &&lambda)						{ return callback(helper<decltype(&L::operator())>::template lambda<L>, &lambda); }
 	//template<auto F, typename C, typename...A> static auto make_method()	{ return helper2<std::index_sequence_for<A...>, C, A...>::template f<F>; }
 	template<typename C, typename...A> static auto make_constructor()		{ return callback(constructor_helper2<std::index_sequence_for<A...>, C, A...>::f); }
+	template<typename C, typename...A> static auto make_shared_constructor(){ return callback(constructor_helper2<std::index_sequence_for<A...>, C, A...>::shared); }
     
 	constexpr callback(napi_callback cb, void *data = nullptr) : cb(cb), data(data) {}
 };
@@ -217,7 +754,7 @@ template<typename F> struct property_maker;
 template<typename C, typename T, T C::*field> napi_value getter(napi_env env, napi_callback_info info) {
 	napi_value	this_arg;
 	napi_get_cb_info(global_env, info, nullptr, nullptr, &this_arg, nullptr);
-	return to_value(wrapped<C>(this_arg)->*field);
+	return metrics::measure<metered<field>, metrics::get<field>>([&] { return to_value(wrapped<C>(this_arg)->*field); });
 }
 
 template<typename C, typename T, T C::*field> napi_value setter(napi_env env, napi_callback_info info) {
@@ -225,9 +762,10 @@ template<typename C, typename T, T C::*field> napi_value setter(napi_env env, na
 	napi_value	argv[1];
 	napi_value	this_arg;
 	napi_get_cb_info(global_env, info, &argc, argv, &this_arg, nullptr);
-	auto ret = from_value<T>(argv[0]);
-	wrapped<C>(this_arg)->*field = ret;
-	return ret;
+	return metrics::measure<metered<field>, metrics::set<field>>([&]() -> napi_value {
+		wrapped<C>(this_arg)->*field = from_value<T>(argv[0]);
+		return nullptr;
+	});
 }
 
 template<typename C, typename T> struct property_maker<T C::*> {
@@ -238,7 +776,7 @@ template<typename C, typename T> struct property_maker<T C::*> {
 
 template<typename C, typename T> struct property_maker<const T C::*> {
 	template<const T C::*field> static property_fields make() {
-		return {nullptr, getter<C, T, field>, nullptr};
+		return {nullptr, getter<C, const T, field>, nullptr};
 	}
 };
 
@@ -300,12 +838,12 @@ public:
 
 struct _undefined {
 	static bool 	is(napi_value v)	{ return global_env.type(v) == napi_undefined; }
-	operator napi_value() const { static napi_value v(global_env.api<napi_get_undefined>()()); return v; }
+	operator napi_value() const { static NODE_PER_ENV napi_value v(global_env.api<napi_get_undefined>()()); return v; }
 } undefined;
 
 struct _null {
 	static bool 	is(napi_value v)	{ return global_env.type(v) == napi_null; }
-	operator napi_value() const { static napi_value v(global_env.api<napi_get_null>()()); return v; }
+	operator napi_value() const { static NODE_PER_ENV napi_value v(global_env.api<napi_get_null>()()); return v; }
 } null;
 
 //-----------------------------------------------------------------------------
@@ -317,13 +855,26 @@ protected:
 	napi_ref	v;
 public:
 	ref() : v(nullptr) {}
-	ref(napi_ref v) : v(v) {}
-	ref(napi_value value, uint32_t initial_refcount = 1) { global_env.api<napi_create_reference>()(value, initial_refcount, &v); }
-	ref(ref &&b) : v(b.detach())	{}
-	~ref()							{ if (v) napi_delete_reference(global_env, v); }
-	auto& operator=(ref &&b)		{ swap(v, b.v); return *this; }
+	ref(napi_ref v) : v(v)			{ if (v) leaks::add(leaks::refs, 1); }
+	ref(napi_value value, uint32_t initial_refcount = 1) { global_env.api<napi_create_reference>()(value, initial_refcount, &v); if (v) leaks::add(leaks::refs, 1); }
+	ref(ref &&b) : v(exchange(b.v, nullptr))	{}
+	~ref()							{ reset(); }
+	auto& operator=(ref &&b)		{ reset(b.detach()); return *this; }
+
+	static ref	weak(napi_value value)	{ return ref(value, 0); }
+
+	void		reset(napi_ref r = nullptr)	{
+		if (v) {
+			napi_delete_reference(global_env, v);
+			leaks::add(leaks::refs, -1);
+		}
+		if ((v = r))
+			leaks::add(leaks::refs, 1);
+	}
 
-	napi_ref	detach()			{ return exchange(v, nullptr); }
+	// the caller owns the reference from here, so it is no longer counted
+	napi_ref	detach()			{ if (v) leaks::add(leaks::refs, -1); return exchange(v, nullptr); }
+	explicit operator bool()	const	{ return !!v; }
 	uint32_t	add_ref()	const	{ return global_env.api<napi_reference_ref>()(v); }
 	uint32_t	release()	const	{ return global_env.api<napi_reference_unref>()(v); }
 	value 		operator*() const	{ return global_env.api<napi_get_reference_value>()(v); }
@@ -337,10 +888,202 @@ template<typename T> struct refT : ref {
 	refT() {}
 	refT(T v, uint32_t initial_refcount = 1) : ref(v, initial_refcount) {}
 	refT(refT &&b) : ref(b.detach())	{}
-	auto& operator=(refT &&b)	{ swap(v, b.v); return *this; }
+	auto& operator=(refT &&b)	{ reset(b.detach()); return *this; }
 	T 	operator*() const	{ return T(global_env.api<napi_get_reference_value>()(v)); }
 };
 
+//-----------------------------------------------------------------------------
+//	value_cache - N values made on first use and kept, such as property keys; never released, so owners are usually static
+//	before NAPI_VERSION 10 a reference can only hold an object, so the values are kept in an array held by one reference
+//-----------------------------------------------------------------------------
+
+// an interned string where the runtime has them
+inline napi_value property_key(const char *name) {
+#if NAPI_VERSION >= 10
+	return global_env.api<node_api_create_property_key_utf8>()(name, NAPI_AUTO_LENGTH);
+#else
+	return global_env.api<napi_create_string_utf8>()(name, NAPI_AUTO_LENGTH);
+#endif
+}
+
+template<size_t N> class value_cache {
+#if NAPI_VERSION >= 10
+	napi_ref	refs[N] = {};
+public:
+	// make(i) is called for each value not yet made
+	template<typename M> napi_value get(size_t i, M &&make) {
+		if (!refs[i])
+			refs[i] = ref(make(i)).detach();
+		return global_env.api<napi_get_reference_value>()(refs[i]);
+	}
+	template<typename M> void	get_all(napi_value *values, M &&make) {
+		for (size_t i = 0; i < N; i++)
+			values[i] = get(i, make);
+	}
+#else
+	napi_ref	holder = nullptr;
+	bool		made[N] = {};
+
+	napi_value	values() {
+		if (holder)
+			return global_env.api<napi_get_reference_value>()(holder);
+		napi_value	a = global_env.api<napi_create_array_with_length>()(N);
+		holder = ref(a).detach();
+		return a;
+	}
+	template<typename M> napi_value get(napi_value a, size_t i, M &&make) {
+		if (!made[i]) {
+			napi_value	v = make(i);
+			napi_set_element(global_env, a, uint32_t(i), v);
+			made[i] = true;
+			return v;
+		}
+		return global_env.api<napi_get_element>()(a, uint32_t(i));
+	}
+public:
+	template<typename M> napi_value get(size_t i, M &&make) {
+		return get(values(), i, make);
+	}
+	template<typename M> void	get_all(napi_value *values, M &&make) {
+		napi_value	a = this->values();
+		for (size_t i = 0; i < N; i++)
+			values[i] = get(a, i, make);
+	}
+#endif
+};
+
+//-----------------------------------------------------------------------------
+//	handle_table - compact 32 bit handles to pooled napi_refs
+//	handle = generation << index_bits | (index + 1), so 0 is never valid
+//	a slot whose generation is used up is retired rather than wrapped, so a stale handle can never match a later value
+//-----------------------------------------------------------------------------
+
+class handle_table {
+public:
+	enum mode : uint8_t { weak = 0, strong = 1 };
+	static constexpr uint32_t index_bits		= 20;
+	static constexpr uint32_t index_mask		= (1u << index_bits) - 1;
+	static constexpr uint32_t max_slots			= index_mask;
+	static constexpr uint32_t max_generation	= ~0u >> index_bits;
+
+	struct handle {
+		uint32_t	v;
+		constexpr handle(uint32_t v = 0) : v(v) {}
+		constexpr uint32_t	index()			const { return (v & index_mask) - 1; }
+		constexpr uint32_t	generation()	const { return v >> index_bits; }
+		constexpr explicit operator bool()	const { return v != 0; }
+		constexpr operator uint32_t()		const { return v; }
+	};
+
+private:
+	struct slot {
+		napi_ref	r;
+		uint32_t	next;		// free list link while unused
+		uint16_t	gen;
+		mode		m;
+		bool		retired()	const { return gen == max_generation; }
+	};
+	alloc_block<slot>	slots;
+	uint32_t			used		= 0;	// high water mark into slots
+	uint32_t			free_head	= ~0u;
+	uint32_t			count		= 0;
+
+	slot*	lookup(handle h) const {
+		auto i = h.index();
+		if (!h || i >= used)
+			return nullptr;
+		auto s = slots.at(i);
+		return s->r && s->gen == h.generation() ? s : nullptr;
+	}
+	uint32_t alloc_slot() {
+		if (free_head != ~0u)
+			return exchange(free_head, slots[free_head].next);
+		if (used == max_slots)
+			return ~0u;
+		if (used == slots.size())
+			slots.resize(max(used * 2, 256u));
+		slots[used].gen = 0;
+		return used++;
+	}
+
+public:
+	handle_table()	{}
+	~handle_table()	{ clear(); }
+
+	handle	add(napi_value value, mode m = strong) {
+		auto	i = alloc_slot();
+		if (i == ~0u)
+			return {};
+		auto&	s = slots[i];
+		if (!global_env.check(napi_create_reference(global_env, value, m, &s.r))) {
+			s.r		= nullptr;
+			s.next	= exchange(free_head, i);
+			return {};
+		}
+		++s.gen;				// generation 0 is reserved, and the slot is retired before it could wrap
+		s.m		= m;
+		++count;
+		return (uint32_t(s.gen) << index_bits) | (i + 1);
+	}
+
+	// returns value(nullptr) for stale handles and for weak refs that have been collected
+	value	get(handle h) const {
+		auto	s = lookup(h);
+		return s ? global_env.api<napi_get_reference_value>()(s->r) : nullptr;
+	}
+	template<typename T> T get(handle h) const { return T(get(h)); }
+	value	operator[](handle h) const	{ return get(h); }
+
+	bool	contains(handle h)	const	{ return !!lookup(h); }
+	size_t	size()				const	{ return count; }
+
+	bool	set_mode(handle h, mode m) {
+		auto	s = lookup(h);
+		if (!s)
+			return false;
+		if (s->m != m) {
+			if (m == strong)
+				napi_reference_ref(global_env, s->r, nullptr);
+			else
+				napi_reference_unref(global_env, s->r, nullptr);
+			s->m = m;
+		}
+		return true;
+	}
+
+	bool	remove(handle h) {
+		auto	s = lookup(h);
+		if (!s)
+			return false;
+		napi_delete_reference(global_env, exchange(s->r, nullptr));
+		if (!s->retired())
+			s->next = exchange(free_head, h.index());
+		--count;
+		return true;
+	}
+
+	// release every reference; generations are kept so outstanding handles stay stale
+	void	clear() {
+		free_head = ~0u;
+		for (uint32_t i = used; i--; ) {
+			auto &s = slots[i];
+			if (s.r)
+				napi_delete_reference(global_env, exchange(s.r, nullptr));
+			if (!s.retired())
+				s.next	= exchange(free_head, i);
+		}
+		count = 0;
+	}
+
+	template<typename F> void for_each(F &&f) const {
+		for (uint32_t i = 0; i < used; i++) {
+			auto &s = slots[i];
+			if (s.r)
+				f(handle((uint32_t(s.gen) << index_bits) | (i + 1)), global_env.api<napi_get_reference_value>()(s.r));
+		}
+	}
+};
+
 
 //-----------------------------------------------------------------------------
 //	value types
@@ -359,8 +1102,10 @@ struct number : value {
 	number(int32_t value)	{ global_env.api<napi_create_int32>()(value, &v); }
 	number(uint32_t value)	{ global_env.api<napi_create_uint32>()(value, &v); }
 	number(int64_t value)	{ global_env.api<napi_create_int64>()(value, &v); }
+#if LONG_MAX == INT_MAX	// where long is 64 bits it is already int64_t (or uint64_t)
 	number(long value)			: number((int32_t)value) {}
 	number(unsigned long value)	: number((uint32_t)value) {}
+#endif
 
 	static number	coerce(value v)		{ return number(global_env.api<napi_coerce_to_number>()(v)); }
 	static number 	is(napi_value v)	{ return number(global_env.type(v) == napi_number ? v : nullptr); }
@@ -369,8 +1114,10 @@ struct number : value {
 	operator int32_t()	const { return global_env.api<napi_get_value_int32>()(v); }
 	operator uint32_t()	const { return global_env.api<napi_get_value_uint32>()(v); }
 	operator int64_t()	const { return global_env.api<napi_get_value_int64>()(v); }
+#if LONG_MAX == INT_MAX
 	operator long()		const { return operator int32_t(); }
 	operator unsigned long()	const { return operator uint32_t(); }
+#endif
 
 	bool operator==(double b)	const { return (double)*this == b; }
 	bool operator!=(double b)	const { return (double)*this != b; }
@@ -409,16 +1156,17 @@ struct string : value {
 	size_t	get_utf16(char16_t* buf, size_t bufsize)	{ return global_env.api<napi_get_value_string_utf16>()(v, buf, bufsize); }
 	size_t	length()									{ return global_env.api<napi_get_value_string_utf16>()(v, nullptr, 0); }
 
-#ifdef NAPI_EXPERIMENTAL
-	static make_external(char* str, size_t length, node_api_nogc_finalize finalize, void* finalize_hint, napi_value* result, bool* copied) {
-		napi_value	result;
-		node_api_create_external_string_latin1(global_env, str, length, finalize, finalize_hint, &result, copied);
-		return string(result);
+#if NAPI_VERSION >= 10
+	// the engine may copy instead (then fin has already run); on failure the result is empty and fin is not called
+	static string	make_external(char* str, size_t length, finalizer fin, bool* copied = nullptr) {
+		napi_value	v;
+		bool		c;
+		return string(node_api_create_external_string_latin1(global_env, str, length, fin.cb, fin.hint, &v, copied ? copied : &c) == napi_ok ? v : nullptr);
 	}
-	static make_external(char16_t* str, size_t length, node_api_nogc_finalize finalize, void* finalize_hint, napi_value* result, bool* copied) {
-		napi_value	result;
-		node_api_create_external_string_utf16(global_env, str, length, finalize, finalize_hint, &result, copied);
-		return string(result);
+	static string	make_external(char16_t* str, size_t length, finalizer fin, bool* copied = nullptr) {
+		napi_value	v;
+		bool		c;
+		return string(node_api_create_external_string_utf16(global_env, str, length, fin.cb, fin.hint, &v, copied ? copied : &c) == napi_ok ? v : nullptr);
 	}
 #endif
 };
@@ -446,20 +1194,31 @@ struct Date : value {
 #if NAPI_VERSION >= 6
 struct bigint : value {
 	struct info {
-		int 		sign_bit;
-		size_t		word_count;
-		uint64_t*	words;
+		int						sign_bit = 0;
+		alloc_block<uint64_t>	words;		// least significant first
 	};
 	explicit bigint(napi_value v) : value(v) {}
 	bigint(int64_t value)				{ global_env.api<napi_create_bigint_int64>()(value, &v); }
 	bigint(uint64_t value)				{ global_env.api<napi_create_bigint_uint64>()(value, &v); }
-	bigint(info def) 					{ global_env.api<napi_create_bigint_words>()(def.sign_bit, def.word_count, def.words, &v); }
+	bigint(const info &def) 			: bigint(def.sign_bit, def.words.size(), def.words.begin()) {}
 	bigint(bool sign_bit, size_t word_count, const uint64_t* words) { global_env.api<napi_create_bigint_words>()(sign_bit, word_count, words, &v); }
 	static bigint 	is(napi_value v)	{ return bigint(global_env.type(v) == napi_bigint ? v : nullptr); }
 
-	operator 	int64_t()				{ int64_t result; bool lossless = global_env.api<napi_get_value_bigint_int64>()(v, &result); return result; }
-	operator 	uint64_t()				{ uint64_t result; bool lossless = global_env.api<napi_get_value_bigint_uint64>()(v, &result); return result; }
-	info		get_info() 				{ info result; napi_get_value_bigint_words(global_env, v, &result.sign_bit, &result.word_count, result.words); return result;}
+	// return false if the value was truncated (or is not a bigint)
+	bool		get(int64_t &result)	const	{ bool lossless = false; return napi_get_value_bigint_int64(global_env, v, &result, &lossless) == napi_ok && lossless; }
+	bool		get(uint64_t &result)	const	{ bool lossless = false; return napi_get_value_bigint_uint64(global_env, v, &result, &lossless) == napi_ok && lossless; }
+
+	operator 	int64_t()		const	{ int64_t result = 0; get(result); return result; }
+	operator 	uint64_t()		const	{ uint64_t result = 0; get(result); return result; }
+
+	size_t		word_count()	const	{ size_t n = 0; napi_get_value_bigint_words(global_env, v, nullptr, &n, nullptr); return n; }
+	info		get_info() 		const	{
+		info	result;
+		size_t	n = word_count();
+		result.words = alloc_block<uint64_t>(n);
+		napi_get_value_bigint_words(global_env, v, &result.sign_bit, &n, result.words.begin());
+		return result;
+	}
 };
 #endif
 
@@ -468,8 +1227,8 @@ struct Promise : value {
 	explicit Promise(napi_value v) : value(v) {}
 	Promise() 								{ global_env.api<napi_create_promise>()(&deferred, &v); }
 	static bool is(napi_value v)			{ return global_env.api<napi_is_promise>()(v); }
-	template<typename T> napi_status resolve(T resolution)	const   { return napi_resolve_deferred(global_env, deferred, to_value(resolution)); }	//deferred is freed
-	template<typename T> napi_status reject(T rejection)	const   { return napi_reject_deferred(global_env, deferred, to_value(rejection)); }	//deferred is freed
+	template<typename T> napi_status resolve(T resolution)	const   { return napi_resolve_deferred(global_env, deferred, to_value(std::move(resolution))); }	//deferred is freed
+	template<typename T> napi_status reject(T rejection)	const   { return napi_reject_deferred(global_env, deferred, to_value(std::move(rejection))); }	//deferred is freed
 };
 
 // Version for void-returning exec functions
@@ -491,7 +1250,7 @@ auto async_work(const char* name, E&& exec, C&& complete)
 		},
 		[](napi_env env, napi_status status, void* data) {
 			auto work = (WorkData*)data;
-			save(global_env.env, env);
+			save	s(global_env.env, env);
 			work->complete(status);
 			napi_delete_async_work(env, work->work);
 			delete work;
@@ -522,7 +1281,7 @@ auto async_work(const char* name, E&& exec, C&& complete) -> std::enable_if_t<!s
 		},
 		[](napi_env env, napi_status status, void* data) {
 			auto work = (WorkData*)data;
-			save(global_env.env, env);
+			save	s(global_env.env, env);
 			work->complete(status, work->result);
 			napi_delete_async_work(env, work->work);
 			delete work;
@@ -550,25 +1309,289 @@ template<> struct node_type<napi_value>			: interop<napi_value, napi_value> {};
 template<> struct node_type<double>				: interop<double, number> {};
 template<> struct node_type<int32_t>			: interop<int32_t, number> {};
 template<> struct node_type<uint32_t>			: interop<uint32_t, number> {};
-template<> struct node_type<int64_t>			: interop<int64_t, number> {};
-template<> struct node_type<uint64_t>			: interop<uint64_t, bigint> {};
 template<> struct node_type<bool>				: interop<bool, boolean> {};
 template<> struct node_type<const char*>		: interop<const char*, string> {};
 template<> struct node_type<const char16_t*>	: interop<const char16_t*, string> {};
+#if LONG_MAX == INT_MAX
 template<> struct node_type<long>				: interop<long, number> {};
 template<> struct node_type<unsigned long> 		: interop<unsigned long, number> {};
+#endif
+
+// narrower scalars travel as the wider type number handles
+template<typename F, typename W> struct narrow_interop {
+	static napi_value to_value(F x)         { return number(W(x)); }
+	static F from_value(napi_value x)		{ return F(W(number(x))); }
+};
+template<> struct node_type<float>				: narrow_interop<float, double> {};
+template<> struct node_type<int8_t>				: narrow_interop<int8_t, int32_t> {};
+template<> struct node_type<uint8_t>			: narrow_interop<uint8_t, uint32_t> {};
+template<> struct node_type<int16_t>			: narrow_interop<int16_t, int32_t> {};
+template<> struct node_type<uint16_t>			: narrow_interop<uint16_t, uint32_t> {};
 //template<typename C, size_t N> struct node_type<fixed_string<C, N>> : interop<fixed_string<C, N>, string> {};
 
-template<typename T> auto to_value(const T &x) {
-	if constexpr (std::is_base_of_v<value, T>) {
-		return x;
+//-----------------------------------------------------------------------------
+//	64 bit integers
+//	int64_mode::number	lossy above 2^53 (the default for int64_t)
+//	int64_mode::checked	a number when it is exact, otherwise a bigint
+//	int64_mode::bigint	always a bigint (the default for uint64_t)
+//	NODE_INT64_MODE and NODE_UINT64_MODE change the defaults; int64_as<T, M> picks a mode for a single binding parameter or result
+//	every mode accepts a number or a bigint from JS; one out of range throws a RangeError
+//-----------------------------------------------------------------------------
+
+#ifndef NODE_INT64_MODE
+#define NODE_INT64_MODE		number
+#endif
+#ifndef NODE_UINT64_MODE
+#define NODE_UINT64_MODE	bigint
+#endif
+
+enum class int64_mode { number, checked, bigint };
+
+template<typename T, int64_mode M> struct int64_as {
+	T	v;
+	int64_as(T v = 0) : v(v) {}
+	operator T() const { return v; }
+};
+
+template<typename T, int64_mode M> struct int64_type {
+	static constexpr T	max_exact	= T(1) << 53;
+	static napi_value to_value(T x) {
+		if (M == int64_mode::bigint || (M == int64_mode::checked && !(x <= max_exact && (!is_signed_v<T> || x >= -max_exact))))
+			return bigint(x);
+		if constexpr (is_signed_v<T>)
+			return number(x);
+		else
+			return number(double(x));
+	}
+	// a value T cannot hold throws a RangeError and converts to 0, rather than being truncated (or, from a number, converted with undefined behaviour)
+	static T from_value(napi_value x) {
+		if (global_env.type(x) == napi_bigint) {
+			T	r = 0;
+			return bigint(x).get(r) ? r : out_of_range();
+		}
+		constexpr double	limit	= is_signed_v<T> ? 9223372036854775808.0 : 18446744073709551616.0;
+		double	d = number(x);
+		return d < limit && d >= (is_signed_v<T> ? -limit : 0.0) ? T(d) : out_of_range();
+	}
+	static T out_of_range() {
+		napi_throw_range_error(global_env, "ERR_OUT_OF_RANGE", is_signed_v<T> ? "not a signed 64 bit integer" : "not an unsigned 64 bit integer");
+		return 0;
+	}
+};
+
+template<> struct node_type<int64_t>	: int64_type<int64_t, int64_mode::NODE_INT64_MODE> {};
+template<> struct node_type<uint64_t>	: int64_type<uint64_t, int64_mode::NODE_UINT64_MODE> {};
+template<typename T, int64_mode M> struct node_type<int64_as<T, M>> : int64_type<T, M> {};
+
+//-----------------------------------------------------------------------------
+//	enums
+//	specialise enum_names<E> with a static constexpr enum_entry<E> entries[] to marshal E by name:
+//	names from JS are read into a stack buffer and found with a perfect hash built at compile time, with no allocation and no strcmp chain
+//	names to JS are made once per env and then reused from a value_cache
+//	enum_mode::number sends the underlying value instead; NODE_ENUM_MODE changes the default, enum_as<E, M> picks a mode for a single binding parameter or result
+//	every mode accepts a name or a number from JS; anything else throws a TypeError and converts to E{}
+//-----------------------------------------------------------------------------
+
+#ifndef NODE_ENUM_MODE
+#define NODE_ENUM_MODE	name
+#endif
+
+enum class enum_mode { name, number };
+
+template<typename E> struct enum_entry {
+	const char	*name;
+	E			value;
+};
+template<typename E> struct enum_names {};
+
+template<typename E, typename = void> constexpr bool has_enum_names = false;
+template<typename E> constexpr bool has_enum_names<E, std::void_t<decltype(enum_names<E>::entries)>> = true;
+
+template<typename E, enum_mode M> struct enum_as {
+	E	v;
+	enum_as(E v = E{}) : v(v) {}
+	operator E() const { return v; }
+};
+
+// a two-level (hash and displace) perfect hash: each name's hash picks a bucket, and each bucket gets the displacement that puts all of its names in free slots
+// buckets are placed largest first, so the search stays short for a few hundred names and well inside the compilers' constexpr limits
+template<typename E, size_t N> struct enum_table {
+	static constexpr size_t	count		= N;
+	static constexpr size_t	num_slots	= [] { size_t n = 1; while (n < N * 2) n <<= 1; return n; }();
+	static constexpr size_t	num_buckets	= num_slots > 4 ? num_slots / 4 : 1;
+	static constexpr uint32_t	max_displacement	= 0x1000;
+	static constexpr uint32_t	max_seed			= 16;
+
+	const enum_entry<E>	*entries;
+	uint16_t			slots[num_slots] = {};			// entry index + 1, or 0
+	uint16_t			displacements[num_buckets] = {};
+	uint32_t			seed		= 0;
+	size_t				max_length	= 0;
+	bool				dense		= true;		// entry i has the value i, so to_value needs no search
+	bool				unique		= true;
+
+	static constexpr size_t	length(const char *s)	{ size_t n = 0; while (s[n]) ++n; return n; }
+	static constexpr bool	equal(const char *a, const char *b) { while (*a && *a == *b) ++a, ++b; return *a == *b; }
+	static constexpr uint32_t	hash(const char *s, size_t n, uint32_t seed) {
+		uint32_t	h = 2166136261u ^ seed;
+		for (size_t i = 0; i < n; i++)
+			h = (h ^ uint8_t(s[i])) * 16777619u;
+		return h ^ (h >> 15);
+	}
+	static constexpr size_t	slot(uint32_t h, uint32_t d) {
+		h += d * 0x9e3779b9u;
+		h = (h ^ (h >> 16)) * 0x85ebca6bu;
+		return (h ^ (h >> 13)) & (num_slots - 1);
+	}
+
+	constexpr enum_table(const enum_entry<E> (&e)[N]) : entries(e) {
+		uint32_t	hashes[N] = {};
+		for (size_t i = 0; i < N; i++) {
+			max_length	= max(max_length, length(e[i].name));
+			dense		= dense && underlying_type_t<E>(e[i].value) == underlying_type_t<E>(i);
+			hashes[i]	= hash(e[i].name, length(e[i].name), 0);
+		}
+		for (; seed < max_seed; ++seed) {
+			if (seed)
+				for (size_t i = 0; i < N; i++)
+					hashes[i] = hash(e[i].name, length(e[i].name), seed);
+			if (place(hashes) || !unique)
+				return;
+		}
+	}
+
+	// groups the names by bucket, then finds each bucket's displacement, largest buckets first
+	// equal names always share a bucket, so duplicates are looked for there and reported on their own, as no seed could ever separate them
+	constexpr bool	place(const uint32_t (&hashes)[N]) {
+		size_t	starts[num_buckets + 1] = {}, order[N] = {}, fill[num_buckets] = {};
+		for (size_t i = 0; i < N; i++)
+			++starts[(hashes[i] & (num_buckets - 1)) + 1];
+		size_t	largest = 0;
+		for (size_t b = 0; b < num_buckets; b++) {
+			largest			= max(largest, starts[b + 1]);
+			starts[b + 1]	+= starts[b];
+		}
+		for (size_t i = 0; i < N; i++) {
+			auto	b = hashes[i] & (num_buckets - 1);
+			for (size_t j = starts[b]; j < starts[b] + fill[b]; j++)
+				unique = unique && !(hashes[order[j]] == hashes[i] && equal(entries[order[j]].name, entries[i].name));
+			order[starts[b] + fill[b]++] = i;
+		}
+		if (!unique)
+			return false;
+
+		for (auto &s : slots)
+			s = 0;
+		for (size_t size = largest; size; --size) {
+			for (size_t b = 0; b < num_buckets; b++) {
+				if (starts[b + 1] - starts[b] != size)
+					continue;
+				uint32_t	d = 0;
+				for (;; ++d) {
+					if (d == max_displacement)
+						return false;
+					size_t	placed = starts[b];
+					for (; placed < starts[b + 1]; ++placed) {
+						auto	&s = slots[slot(hashes[order[placed]], d)];
+						if (s)
+							break;
+						s = uint16_t(order[placed] + 1);
+					}
+					if (placed == starts[b + 1])
+						break;
+					while (placed-- > starts[b])
+						slots[slot(hashes[order[placed]], d)] = 0;
+				}
+				displacements[b] = uint16_t(d);
+			}
+		}
+		return true;
+	}
+	constexpr bool	perfect() const { return unique && seed < max_seed; }
+
+	int	find(const char *s, size_t n) const {
+		auto	h = hash(s, n, seed);
+		int		i = slots[slot(h, displacements[h & (num_buckets - 1)])] - 1;
+		return i >= 0 && length(entries[i].name) == n && memcmp(entries[i].name, s, n) == 0 ? i : -1;
+	}
+	int	index(E v) const {
+		if (dense)
+			return size_t(v) < N ? int(v) : -1;
+		for (size_t i = 0; i < N; i++)
+			if (entries[i].value == v)
+				return int(i);
+		return -1;
+	}
+};
+
+template<typename E, size_t N> constexpr auto make_enum_table(const enum_entry<E> (&e)[N]) { return enum_table<E, N>(e); }
+
+template<typename E, enum_mode M> struct enum_type {
+	static constexpr auto	table = make_enum_table(enum_names<E>::entries);
+	static_assert(table.unique, "enum names must be unique");
+	static_assert(!table.unique || table.perfect(), "no perfect hash was found for the enum names");
+
+	static napi_value to_value(E x) {
+		if constexpr (M == enum_mode::number) {
+			return number(double(underlying_type_t<E>(x)));
+		} else {
+			static NODE_PER_ENV value_cache<table.count>	names;
+			int	i = table.index(x);
+			if (i < 0)
+				return number(double(underlying_type_t<E>(x)));
+			return names.get(i, [](size_t i) { return property_key(table.entries[i].name); });
+		}
+	}
+	static E from_value(napi_value x) {
+		switch (global_env.type(x)) {
+			case napi_string: {
+				// room for a whole extra code point, so a longer string can never truncate to one of the names
+				char	buf[table.max_length + 5];
+				size_t	n;
+				if (napi_get_value_string_utf8(global_env, x, buf, sizeof(buf), &n) == napi_ok) {
+					int	i = table.find(buf, n);
+					if (i >= 0)
+						return table.entries[i].value;
+				}
+				break;
+			}
+			case napi_number: {
+				// only a whole number in range can be cast (NaN fails both comparisons)
+				typedef underlying_type_t<E>	U;
+				double	d = number(x);
+				if (d >= double(std::numeric_limits<U>::min()) && d < double(std::numeric_limits<U>::max()) + 1.0 && double(U(d)) == d) {
+					E	v = E(U(d));
+					if (table.index(v) >= 0)
+						return v;
+				}
+				break;
+			}
+			default:
+				break;
+		}
+		napi_throw_type_error(global_env, "ERR_INVALID_ARG_VALUE", (std::string("not a ") + type_name<E>()).c_str());
+		return E{};
+	}
+};
+
+template<typename E, enum_mode M> struct node_type<enum_as<E, M>> : enum_type<E, M> {};
+
+// rvalues are forwarded, so node_types with a T&& overload can take ownership instead of copying
+template<typename T> auto to_value(T &&x) {
+	typedef std::decay_t<T>	D;
+	if constexpr (std::is_base_of_v<value, D>) {
+		return D(x);
+	} else if constexpr (has_enum_names<D>) {
+		return enum_type<D, enum_mode::NODE_ENUM_MODE>::to_value(x);
 	} else {
-		return node_type<T>::to_value(x);
+		return node_type<D>::to_value(std::forward<T>(x));
 	}
 }
 template<typename T> auto from_value(napi_value x)	{
 	if constexpr (std::is_base_of_v<value, T>) {
 		return T(x);
+	} else if constexpr (has_enum_names<T>) {
+		return enum_type<T, enum_mode::NODE_ENUM_MODE>::from_value(x);
 	} else {
 		return node_type<T>::from_value(x);
 	}
@@ -765,8 +1788,123 @@ struct object_iterator : array_iterator {
 inline auto object::begin() 	{ return object_iterator(*this, keys(), 0); }
 inline auto object::end() 		{ return object_iterator(*this, keys(), -1); }
 
+//-----------------------------------------------------------------------------
+//	scoped iteration and building
+//	temporaries created per element are released every chunk elements instead of living until the binding returns
+//-----------------------------------------------------------------------------
+
+// f(value) or f(value, index)
+template<typename F> void for_each_scoped(array a, F &&f, uint32_t chunk = chunked_scope::default_chunk) {
+	auto			n = a.length();
+	chunked_scope	s(chunk);
+	for (uint32_t i = 0; i < n; i++, s.next()) {
+		if constexpr (std::is_invocable_v<F, value, uint32_t>)
+			f(value(a[i]), i);
+		else
+			f(value(a[i]));
+	}
+}
+
+// f(key, value)
+template<typename F> void for_each_scoped(object o, F &&f, uint32_t chunk = chunked_scope::default_chunk) {
+	auto			keys	= o.keys();
+	auto			n		= keys.length();
+	chunked_scope	s(chunk);
+	for (uint32_t i = 0; i < n; i++, s.next()) {
+		value	key = keys[i];
+		f(key, value(o[key]));
+	}
+}
+
+// acc = f(acc, value); only the accumulator is escaped out of each chunk
+template<typename F> value reduce_scoped(array a, napi_value acc, F &&f, uint32_t chunk = chunked_scope::default_chunk) {
+	auto			n = a.length();
+	chunked_scope	s(chunk);
+	for (uint32_t i = 0; i < n; i++) {
+		acc = to_value(f(value(acc), value(a[i])));
+		s.next(acc);
+	}
+	s.close(acc);
+	return acc;
+}
+
+class array_builder {
+	array			a;
+	uint32_t		n = 0;
+	chunked_scope	s;
+public:
+	array_builder(size_t length = 0, uint32_t chunk = chunked_scope::default_chunk) : a(length), s(chunk) {}
+
+	template<typename T> uint32_t push(const T &t) {
+		a[n] = to_value(t);
+		s.next();
+		return n++;
+	}
+	uint32_t	size()		const	{ return n; }
+	array		finish()			{ s.close(); return a; }
+};
+
+template<typename F> array map_scoped(array a, F &&f, uint32_t chunk = chunked_scope::default_chunk) {
+	auto			n = a.length();
+	array_builder	b(n, chunk);
+	for (uint32_t i = 0; i < n; i++)
+		b.push(f(value(a[i])));
+	return b.finish();
+}
+
+//-----------------------------------------------------------------------------
+//	shape - a fixed key list for building many objects of the same form
+//	the keys are made once and kept in a value_cache, and each object is filled by a single napi_define_properties
+//	(no released Node-API version up to Node 22 can create an object and its properties in one call, so there is no NAPI_VERSION path for it here)
+//	a shape belongs to the env that first uses it, so with NODE_WORKER_THREADS declare it NODE_PER_ENV
+//-----------------------------------------------------------------------------
+
+template<size_t N> class shape {
+	const char		*names[N];
+	value_cache<N>	keys;
+
+	void	descriptors(napi_property_descriptor *d) {
+		napi_value	k[N];
+		keys.get_all(k, [this](size_t i) { return property_key(names[i]); });
+		for (size_t i = 0; i < N; i++)
+			d[i] = {nullptr, k[i], nullptr, nullptr, nullptr, nullptr, napi_property_attributes(napi_writable | napi_enumerable | napi_configurable), nullptr};
+	}
+	template<typename T> static object	fill(napi_property_descriptor *d, T &&values) {
+		object	o;
+		std::apply([d](auto&&...x) {
+			size_t	i = 0;
+			((d[i++].value = to_value(std::forward<decltype(x)>(x))), ...);
+		}, std::forward<T>(values));
+		napi_define_properties(global_env, o, N, d);
+		return o;
+	}
+
+public:
+	template<typename...K> constexpr shape(K...names) : names{names...} { static_assert(sizeof...(K) == N, "one name per key"); }
+
+	// the values in key order
+	template<typename...V> object	make(V&&...values) {
+		static_assert(sizeof...(V) == N, "one value per key");
+		napi_property_descriptor	d[N];
+		descriptors(d);
+		return fill(d, std::forward_as_tuple(std::forward<V>(values)...));
+	}
+
+	// an array with an object per row; f(row) returns a tuple of the values in key order, and its temporaries are released every chunk rows
+	template<typename C, typename F> array	make_array(const C &rows, F &&f, uint32_t chunk = chunked_scope::default_chunk) {
+		napi_property_descriptor	d[N];
+		descriptors(d);				// in the caller's scope, so the key handles outlive every chunk
+		array_builder	b(rows.size(), chunk);
+		for (auto &r : rows)
+			b.push(fill(d, f(r)));
+		return b.finish();
+	}
+};
+
+template<typename...K> shape(K...) -> shape<sizeof...(K)>;
+
 struct _global {
-	napi_value	get()	    const { static napi_value v(global_env.api<napi_get_global>()()); return v; }
+	napi_value	get()	    const { return global_env.api<napi_get_global>()(); }	// a handle in the current scope, so not cached
 	operator napi_value()	const { return get(); }
 	operator object()		const { return object(get()); }
 	auto	operator->()	const { return ref_helper<object>(operator object()); }
@@ -800,7 +1938,7 @@ public:
 	ArrayBuffer() {}
 	ArrayBuffer(size_t byte_length, void** data = nullptr) { global_env.api<napi_create_arraybuffer>()(byte_length, data, &v); }
 #ifndef NODE_API_NO_EXTERNAL_BUFFERS_ALLOWED
-	ArrayBuffer(void* external_data, size_t byte_length, finalizer fin) {
+	ArrayBuffer(void* external_data, size_t byte_length, finalizer fin) : value(nullptr) {
 		global_env.api<napi_create_external_arraybuffer>()(external_data, byte_length, fin.cb, fin.hint, &v);
 	}
 #endif
@@ -818,17 +1956,17 @@ struct uint8_clamped {
 };
 
 template<typename T> static constexpr auto typedarray_type = -1;
-template<> static constexpr auto typedarray_type<int8_t>		= napi_int8_array;
-template<> static constexpr auto typedarray_type<uint8_t>		= napi_uint8_array;
-template<> static constexpr auto typedarray_type<int16_t>		= napi_int16_array;
-template<> static constexpr auto typedarray_type<uint16_t>		= napi_uint16_array;
-template<> static constexpr auto typedarray_type<int32_t>		= napi_int32_array;
-template<> static constexpr auto typedarray_type<uint32_t>		= napi_uint32_array;
-template<> static constexpr auto typedarray_type<float>			= napi_float32_array;
-template<> static constexpr auto typedarray_type<double>		= napi_float64_array;
-template<> static constexpr auto typedarray_type<int64_t>		= napi_bigint64_array;
-template<> static constexpr auto typedarray_type<uint64_t>		= napi_biguint64_array;
-template<> static constexpr auto typedarray_type<uint8_clamped>	= napi_uint8_clamped_array;
+template<> constexpr auto typedarray_type<int8_t>		= napi_int8_array;
+template<> constexpr auto typedarray_type<uint8_t>		= napi_uint8_array;
+template<> constexpr auto typedarray_type<int16_t>		= napi_int16_array;
+template<> constexpr auto typedarray_type<uint16_t>		= napi_uint16_array;
+template<> constexpr auto typedarray_type<int32_t>		= napi_int32_array;
+template<> constexpr auto typedarray_type<uint32_t>		= napi_uint32_array;
+template<> constexpr auto typedarray_type<float>			= napi_float32_array;
+template<> constexpr auto typedarray_type<double>		= napi_float64_array;
+template<> constexpr auto typedarray_type<int64_t>		= napi_bigint64_array;
+template<> constexpr auto typedarray_type<uint64_t>		= napi_biguint64_array;
+template<> constexpr auto typedarray_type<uint8_clamped>	= napi_uint8_clamped_array;
 
 template<typename T> struct TypedArray : value {
 	static TypedArray is(napi_value v) {
@@ -840,6 +1978,7 @@ template<typename T> struct TypedArray : value {
 		}
 		return TypedArray(nullptr);
 	}
+	TypedArray() {}
 	explicit TypedArray(napi_value v) : value(v) {}
 	TypedArray(ArrayBuffer arraybuffer, size_t byte_offset, size_t length) {
 		global_env.api<napi_create_typedarray>()(typedarray_type<T>, length, arraybuffer, byte_offset, &v);
@@ -860,9 +1999,13 @@ template<typename T> struct TypedArray : value {
 	}
 };
 
+// a range does not own its memory, so it is copied
 template<typename C> struct node_type<range<C*>> {
 	static napi_value to_value(range<C*> x) {
-		return TypedArray<C>(x.size(), ArrayBuffer(x.begin(), x.size(), [](void* data) {}), 0);
+		remove_const_t<C>*	d;
+		TypedArray<remove_const_t<C>>	a(x.size(), &d);
+		copyn(d, x.begin(), x.size());
+		return a;
 	}
 	static auto from_value(napi_value x) {
         if (auto array = TypedArray<C>::is(x))
@@ -872,9 +2015,18 @@ template<typename C> struct node_type<range<C*>> {
 };
 
 struct DataView : value {
+	// unaligned and bounds checked; byte order defaults to host like the original raw accessors (JS defaults to big endian)
 	struct _native : range<byte*> {
-		template<typename T> T		get(size_t offset) 		{ return *(T*)at(offset); }
-		template<typename T> void	set(T t, size_t offset) { *(T*)at(offset) = t; }
+		template<typename T> bool	fits(size_t offset)	const	{ return offset <= size() && size() - offset >= sizeof(T); }
+		template<typename T> T		get(size_t offset, bool little = !host_big_endian) const {
+			return fits<T>(offset) ? load_endian<T>(at(offset), !little) : T();
+		}
+		template<typename T> bool	set(T t, size_t offset, bool little = !host_big_endian) {
+			if (!fits<T>(offset))
+				return false;
+			store_endian(at(offset), t, !little);
+			return true;
+		}
 	};
 	static DataView is(napi_value v) { return DataView(global_env.api<napi_is_dataview>()(v) ? v : nullptr); }
 	explicit DataView(napi_value v) : value(v) {}
@@ -894,6 +2046,601 @@ struct DataView : value {
 };
 
 
+// bytes viewed by an ArrayBuffer, TypedArray or DataView (empty for anything else)
+inline range<byte*> binary_data(napi_value v) {
+	if (global_env.api<napi_is_arraybuffer>()(v))
+		return ArrayBuffer(v).native();
+
+	void*	data	= nullptr;
+	size_t	length	= 0;
+	if (global_env.api<napi_is_typedarray>()(v)) {
+		napi_typedarray_type type;
+		napi_get_typedarray_info(global_env, v, &type, &length, &data, nullptr, nullptr);
+		static const uint8_t sizes[] = {1, 1, 1, 2, 2, 4, 4, 4, 8, 8, 8};
+		return {(byte*)data, length * (type < num_elements(sizes) ? sizes[type] : 1)};
+	}
+	if (global_env.api<napi_is_dataview>()(v))
+		return DataView(v).native();
+	return {};
+}
+
+//-----------------------------------------------------------------------------
+//	Buffer - node's Uint8Array subclass
+//-----------------------------------------------------------------------------
+
+struct Buffer : TypedArray<uint8_t> {
+	// newer runtimes also accept a plain Uint8Array here
+	static Buffer	is(napi_value v)	{ return Buffer(global_env.api<napi_is_buffer>()(v) ? v : nullptr); }
+	explicit Buffer(napi_value v) : TypedArray<uint8_t>(v) {}
+	Buffer(size_t length, byte** data = nullptr) { global_env.api<napi_create_buffer>()(length, (void**)data, &v); }
+#ifndef NODE_API_NO_EXTERNAL_BUFFERS_ALLOWED
+	Buffer(void* external_data, size_t length, finalizer fin) {
+		global_env.api<napi_create_external_buffer>()(length, external_data, fin.cb, fin.hint, &v);
+	}
+#endif
+#if NAPI_VERSION >= 10
+	// a view onto part of an existing ArrayBuffer
+	Buffer(ArrayBuffer arraybuffer, size_t byte_offset, size_t length) {
+		global_env.api<node_api_create_buffer_from_arraybuffer>()(arraybuffer, byte_offset, length, &v);
+	}
+#endif
+	static Buffer	copy(range<const byte*> src, byte** data = nullptr) {
+		return Buffer(global_env.api<napi_create_buffer_copy>()(src.size(), src.begin(), (void**)data));
+	}
+
+	range<byte*> native() {
+		void*	data	= nullptr;
+		size_t	length	= 0;
+		napi_get_buffer_info(global_env, v, &data, &length);
+		return {(byte*)data, length};
+	}
+};
+
+//-----------------------------------------------------------------------------
+//	buffer_pool - carves small Buffers out of shared slabs, like node's own Buffer.allocUnsafe pool
+//	each slab is one ArrayBuffer that stays alive while any Buffer cut from it does
+//	below N-API 10 the views are made by Buffer.from(slab, offset, length)
+//-----------------------------------------------------------------------------
+
+class buffer_pool {
+	refT<ArrayBuffer>	slab;
+	byte*		base	= nullptr;
+	size_t		used	= slab_size;
+#if NAPI_VERSION < 10
+	ref			from;
+#endif
+
+	void	new_slab() {
+		void*		data;
+		ArrayBuffer	a(slab_size, &data);
+		slab	= refT<ArrayBuffer>(a);
+		base	= (byte*)data;
+		used	= 0;
+	}
+
+public:
+	static constexpr size_t slab_size	= 64 * 1024;
+	static constexpr size_t max_pooled	= 4096;		// larger Buffers get their own allocation
+	static constexpr size_t align		= 8;
+
+	// one pool per env, as slabs cannot be shared between envs; the refs are released by an env cleanup hook, as the static pool outlives the env
+	static buffer_pool&	get() {
+		static NODE_PER_ENV buffer_pool	pool;
+		static NODE_PER_ENV bool		hooked = napi_add_env_cleanup_hook(global_env, [](void *p) {
+			auto	pool = (buffer_pool*)p;
+			pool->slab.reset();
+		#if NAPI_VERSION < 10
+			pool->from.reset();
+		#endif
+			pool->used = slab_size;
+		}, &pool) == napi_ok;
+		(void)hooked;
+		return pool;
+	}
+
+	Buffer	alloc(size_t length, byte** data = nullptr) {
+		if (length > max_pooled)
+			return Buffer(length, data);
+
+		if (used + length > slab_size)
+			new_slab();
+
+		size_t	offset	= used;
+		used = (offset + length + align - 1) & ~(align - 1);
+		if (data)
+			*data = base + offset;
+	#if NAPI_VERSION >= 10
+		return Buffer(*slab, offset, length);
+	#else
+		if (!from) {
+			object	buffer{value(global["Buffer"])};
+			from = ref(value(buffer["from"]));
+		}
+		napi_value	args[] = {*slab, number(double(offset)), number(double(length))};
+		return Buffer(global_env.api<napi_call_function>()(undefined, *from, 3, args));
+	#endif
+	}
+
+	Buffer	copy(range<const byte*> src) {
+		byte*	data;
+		auto	b = alloc(src.size(), &data);
+		if (src.size())
+			memcpy(data, src.begin(), src.size());
+		return b;
+	}
+};
+
+//-----------------------------------------------------------------------------
+//	owning containers
+//	returning one by value (or passing an rvalue to to_value) hands its storage to JS, released by a finalizer that matches the allocation
+//	lvalues are copied
+//-----------------------------------------------------------------------------
+
+// if the runtime refuses external buffers (eg. electron), the data is copied and released immediately
+inline ArrayBuffer adopt_buffer(void *data, size_t size, finalizer fin) {
+#ifndef NODE_API_NO_EXTERNAL_BUFFERS_ALLOWED
+	napi_value	v;
+	if (size && napi_create_external_arraybuffer(global_env, data, size, fin.cb, fin.hint, &v) == napi_ok)
+		return ArrayBuffer(v);
+#endif
+	void*		copy;
+	ArrayBuffer	a(size, &copy);
+	if (size)
+		memcpy(copy, data, size);
+	fin.cb(global_env, data, fin.hint);
+	return a;
+}
+
+template<typename T> TypedArray<T> adopt_typed(T *data, size_t n, finalizer fin) {
+	return TypedArray<T>(adopt_buffer(data, n * sizeof(T), fin), 0, n);
+}
+
+template<typename T> alloc_block<T> typed_copy(napi_value x) {
+	auto	src = TypedArray<T>::is(x).native();
+	alloc_block<T>	r(src.size());
+	copyn(r.begin(), src.begin(), src.size());
+	return r;
+}
+
+template<typename T> struct node_type<alloc_block<T>> {
+	static napi_value to_value(const alloc_block<T> &x) { return node_type<range<T*>>::to_value(x); }
+	static napi_value to_value(alloc_block<T> &&x) {
+		size_t	n = x.size();
+		// released the way alloc_block itself would: free for trivial types, delete[] otherwise
+		return adopt_typed(x.detach(), n, finalizer([](node_api_nogc_env, void *data, void*) {
+			if constexpr (is_trivial_v<T>)
+				free(data);
+			else
+				delete[] (T*)data;
+		}, nullptr));
+	}
+	static auto from_value(napi_value x) { return typed_copy<T>(x); }
+};
+
+// only the written part [a, p) is handed over; the block is shrunk to it first
+template<typename T> struct node_type<growing_block<T>> {
+	static napi_value to_value(const growing_block<T> &x) { return node_type<range<T*>>::to_value(range<T*>(x.begin(), x.p)); }
+	static napi_value to_value(growing_block<T> &&x) {
+		if (x.tell() < x.size())
+			x.resize(x.tell());
+		return node_type<alloc_block<T>>::to_value(std::move(x));
+	}
+};
+
+// a vector cannot release its storage, so it is moved into a heap vector that the finalizer deletes
+template<typename T> struct node_type<std::vector<T>> {
+	static napi_value to_value(const std::vector<T> &x) { return node_type<range<const T*>>::to_value(range<const T*>(x.data(), x.size())); }
+	static napi_value to_value(std::vector<T> &&x) {
+		auto	v = new std::vector<T>(std::move(x));
+		return adopt_typed(v->data(), v->size(), finalizer([](node_api_nogc_env, void*, void *hint) { delete (std::vector<T>*)hint; }, v));
+	}
+	// a plain array is converted element by element (eg. a mix of numbers and bigints)
+	static auto from_value(napi_value x) {
+		if (auto a = array::is(x)) {
+			std::vector<T>	r(a.length());
+			for (uint32_t i = 0; i < r.size(); i++)
+				r[i] = Node::from_value<T>(value(a[i]));
+			return r;
+		}
+		auto	src = TypedArray<T>::is(x).native();
+		return std::vector<T>(src.begin(), src.end());
+	}
+};
+
+// V8 only adopts latin1 and utf16 external strings, so a utf8 std::string is handed over only when it is pure ascii
+template<> struct node_type<std::string> {
+	static napi_value to_value(const std::string &x) { return string(x.data(), x.size()); }
+	static napi_value to_value(std::string &&x) {
+	#if NAPI_VERSION >= 10
+		size_t	n = x.size();
+		if (n >= external_threshold && is_ascii(x.data(), n)) {
+			auto	s = new std::string(std::move(x));
+			if (auto v = string::make_external(s->data(), n, finalizer([](node_api_nogc_env, void*, void *hint) { delete (std::string*)hint; }, s)))
+				return v;
+			x = std::move(*s);
+			delete s;
+		}
+	#endif
+		return to_value(x);
+	}
+	static auto from_value(napi_value x) {
+		string	s(x);
+		std::string	r(s.get_utf8(nullptr, 0), '\0');
+		s.get_utf8(r.data(), r.size() + 1);
+		return r;
+	}
+	// short strings are copied by the engine anyway
+	static constexpr size_t external_threshold = 256;
+	static bool is_ascii(const char *p, size_t n) {
+		uint8_t	any = 0;
+		for (size_t i = 0; i < n; i++)
+			any |= p[i];
+		return !(any & 0x80);
+	}
+};
+
+template<> struct node_type<std::u16string> {
+	static napi_value to_value(const std::u16string &x) { return string(x.data(), x.size()); }
+	static napi_value to_value(std::u16string &&x) {
+	#if NAPI_VERSION >= 10
+		size_t	n = x.size();
+		if (n >= node_type<std::string>::external_threshold) {
+			auto	s = new std::u16string(std::move(x));
+			if (auto v = string::make_external(s->data(), n, finalizer([](node_api_nogc_env, void*, void *hint) { delete (std::u16string*)hint; }, s)))
+				return v;
+			x = std::move(*s);
+			delete s;
+		}
+	#endif
+		return to_value(x);
+	}
+	static auto from_value(napi_value x) {
+		string	s(x);
+		std::u16string	r(s.get_utf16(nullptr, 0), u'\0');
+		s.get_utf16(r.data(), r.size() + 1);
+		return r;
+	}
+};
+
+//-----------------------------------------------------------------------------
+//	scheduled jobs - async_work with priorities, deadlines and cancellation
+//	each job queues one napi_async_work as a slot on the libuv pool, but a slot runs whichever of its env's jobs is most urgent when it starts,
+//	so high priority jobs overtake queued low priority ones, and cancelled or expired jobs are dropped without running
+//-----------------------------------------------------------------------------
+
+enum class job_priority : uint8_t { high, normal, low };
+enum class job_status : uint8_t { queued, running, done, cancelled, expired };
+
+class job_base {
+	friend class job_queue;
+	std::atomic<int>		refs{1};
+	std::atomic<bool>		cancel_requested{false};
+	napi_ref				signal = nullptr, listener = nullptr;	// an AbortSignal the job listens to (main thread only)
+public:
+	typedef std::chrono::steady_clock	clock;
+	std::atomic<job_status>	status{job_status::queued};
+	job_priority			priority;
+	clock::time_point		deadline;
+
+	job_base(job_priority priority, double timeout_ms) : priority(priority), deadline(timeout_ms > 0 ? clock::now() + std::chrono::microseconds(int64_t(timeout_ms * 1000)) : clock::time_point::max()) {}
+	virtual ~job_base() {}
+	virtual void	execute()	= 0;	// pool thread
+	virtual void	complete()	= 0;	// main thread, once, whatever the outcome
+
+	void	add_ref()			{ ++refs; }
+	void	release()			{ if (--refs == 0) delete this; }
+	// exec functions taking a const job_base& can poll this to stop early
+	bool	cancelled()	const	{ return cancel_requested; }
+	bool	expired()	const	{ return clock::now() > deadline; }
+
+	// the signal's listener holds a reference to the job until the job finishes
+	void	listen(object signal) {
+		napi_value	f;
+		napi_create_function(global_env, "abort", NAPI_AUTO_LENGTH, [](napi_env env, napi_callback_info info) -> napi_value {
+			void*	data;
+			napi_get_cb_info(env, info, nullptr, nullptr, nullptr, &data);
+			save	s(global_env.env, env);
+			((job_base*)data)->cancel();
+			return nullptr;
+		}, this, &f);
+		add_ref();
+		napi_create_reference(global_env, signal, 1, &this->signal);
+		napi_create_reference(global_env, f, 1, &listener);
+		signal.call("addEventListener", string("abort"), value(f));
+	}
+	void	finish() {
+		complete();
+		if (signal) {
+			ref	s(exchange(signal, nullptr)), l(exchange(listener, nullptr));
+			object(*s).call("removeEventListener", string("abort"), *l);
+			release();
+		}
+		release();
+	}
+	void	cancel();
+};
+
+class job_queue {
+	struct slot {
+		job_queue				*queue;
+		napi_async_work			work	= nullptr;
+		job_base				*ran	= nullptr;
+		std::vector<job_base*>	dropped;
+		slot(job_queue *queue) : queue(queue) {}
+	};
+	std::mutex				mutex;
+	std::deque<job_base*>	queues[3];
+
+	job_base*	pop(slot *s) {
+		std::lock_guard<std::mutex>	lock(mutex);
+		for (auto &q : queues) {
+			while (!q.empty()) {
+				auto	j = q.front();
+				q.pop_front();
+				if (j->cancelled() || j->expired()) {
+					j->status = j->cancelled() ? job_status::cancelled : job_status::expired;
+					s->dropped.push_back(j);
+					continue;
+				}
+				j->status = job_status::running;
+				return j;
+			}
+		}
+		return nullptr;
+	}
+
+public:
+	// one queue per JS thread, so slots only ever run jobs of the env that created them
+	static job_queue&	get()	{ static thread_local job_queue q; return q; }
+
+	void	push(job_base *j, const char *name) {
+		{
+			std::lock_guard<std::mutex>	lock(mutex);
+			queues[int(j->priority)].push_back(j);
+		}
+		auto	s = new slot(this);
+		napi_create_async_work(global_env, nullptr, string(name),
+			[](napi_env, void *data) {
+				auto	s = (slot*)data;
+				if ((s->ran = s->queue->pop(s))) {
+					s->ran->execute();
+					s->ran->status = s->ran->cancelled() ? job_status::cancelled : job_status::done;
+				}
+			},
+			[](napi_env env, napi_status, void *data) {
+				auto	s = (slot*)data;
+				save	sv(global_env.env, env);
+				for (auto j : s->dropped)
+					j->finish();
+				if (s->ran)
+					s->ran->finish();
+				napi_delete_async_work(env, s->work);
+				delete s;
+			},
+			s, &s->work);
+		napi_queue_async_work(global_env, s->work);
+	}
+
+	// true if the job was still queued, in which case it is completed now as cancelled
+	bool	remove(job_base *j) {
+		{
+			std::lock_guard<std::mutex>	lock(mutex);
+			auto	&q = queues[int(j->priority)];
+			for (auto i = q.begin(); ; ++i) {
+				if (i == q.end())
+					return false;
+				if (*i == j) {
+					q.erase(i);
+					break;
+				}
+			}
+		}
+		j->status = job_status::cancelled;
+		j->finish();
+		return true;
+	}
+};
+
+// main thread; a running job finishes as cancelled unless it had already completed its work
+inline void job_base::cancel() {
+	if (!cancel_requested.exchange(true) && status == job_status::queued)
+		job_queue::get().remove(this);
+}
+
+template<typename E, typename C> class job : public job_base {
+	static constexpr bool	polls	= std::is_invocable_v<E&, const job_base&>;
+	typedef typename if_t<polls, std::invoke_result<E&, const job_base&>, std::invoke_result<E&>>::type	R;
+	typedef if_t<std::is_void_v<R>, _none, R>			S;
+	E	exec;
+	C	done;
+	S	result{};
+public:
+	job(E exec, C done, job_priority priority, double timeout_ms) : job_base(priority, timeout_ms), exec(std::move(exec)), done(std::move(done)) {}
+	void	execute() override {
+		auto	run = [this]() -> decltype(auto) { if constexpr (polls) return exec(*this); else return exec(); };
+		if constexpr (std::is_void_v<R>)
+			run();
+		else
+			result = run();
+	}
+	// done(job_status) for void jobs, otherwise done(job_status, R&&); the result is only meaningful with job_status::done
+	void	complete() override {
+		if constexpr (std::is_void_v<R>)
+			done(status.load());
+		else
+			done(status.load(), std::move(result));
+	}
+};
+
+struct job_options {
+	job_priority	priority	= job_priority::normal;
+	double			timeout_ms	= 0;		// a job still queued this long after submission is dropped; 0 never expires
+
+	job_options() {}
+	job_options(job_priority priority, double timeout_ms = 0) : priority(priority), timeout_ms(timeout_ms) {}
+	// from JS: {priority: 'high' | 'normal' | 'low', timeout: ms}; null (no options given) keeps the defaults
+	job_options(napi_value v) {
+		if (!v)
+			return;
+		object	o	= object::is(v);
+		if (!o)
+			return;
+		if (string p = string::is(value(o["priority"]))) {
+			char	name[8];
+			p.get_utf8(name, sizeof(name));
+			priority = strcmp(name, "high") == 0 ? job_priority::high : strcmp(name, "low") == 0 ? job_priority::low : job_priority::normal;
+		}
+		if (number t = number::is(value(o["timeout"])))
+			timeout_ms = t;
+	}
+};
+
+class job_handle {
+	job_base	*j;
+public:
+	job_handle(job_base *j = nullptr) : j(j)			{ if (j) j->add_ref(); }
+	job_handle(const job_handle &b) : job_handle(b.j)	{}
+	job_handle(job_handle &&b) : j(exchange(b.j, nullptr)) {}
+	~job_handle()										{ if (j) j->release(); }
+	job_handle& operator=(job_handle b)					{ swap(j, b.j); return *this; }
+
+	explicit operator bool()	const	{ return !!j; }
+	job_base*	get()			const	{ return j; }
+	job_status	status()		const	{ return j->status; }
+	void		cancel()		const	{ j->cancel(); }
+};
+
+template<typename E, typename C> job_handle schedule_work(const char *name, E &&exec, C &&done, job_options options = {}) {
+	auto		j = new job<std::decay_t<E>, std::decay_t<C>>(std::forward<E>(exec), std::forward<C>(done), options.priority, options.timeout_ms);
+	job_handle	h(j);
+	job_queue::get().push(j, name);
+	return h;
+}
+
+// matches the errors node's own abortable APIs reject with
+inline error	abort_error(job_status status) {
+	bool	expired = status == job_status::expired;
+	error	e(string("ABORT_ERR"), string(expired ? "The job missed its deadline" : "The operation was aborted"));
+	object	o(e);
+	o["name"] = string(expired ? "TimeoutError" : "AbortError");
+	return e;
+}
+
+// a Promise of the converted result; options may hold {signal: AbortSignal, priority, timeout}
+template<typename E> Promise async_job(const char *name, E &&exec, napi_value options = nullptr) {
+	Promise		p;
+	job_options	opts(options);
+	object		o		= options ? object::is(options) : object(nullptr);
+	object		signal	= o ? object::is(value(o["signal"])) : object(nullptr);
+	if (signal && boolean(value(signal["aborted"]))) {
+		p.reject(abort_error(job_status::cancelled));
+		return p;
+	}
+
+	auto	h = schedule_work(name, std::forward<E>(exec), [p](job_status status, auto &&...result) {
+		if (status != job_status::done)
+			p.reject(abort_error(status));
+		else if constexpr (sizeof...(result) == 0)
+			p.resolve((napi_value)undefined);
+		else
+			p.resolve(std::move(result)...);
+	}, opts);
+
+	if (signal)	// the job may already be running, but it cannot have finished yet
+		h.get()->listen(signal);
+	return p;
+}
+
+//-----------------------------------------------------------------------------
+//	prepared_call - a JS function called many times from a native loop
+//	the function, receiver and argv array are resolved once, and each call converts only the arguments it is given
+//	every call runs in its own handle scope
+//-----------------------------------------------------------------------------
+
+template<typename...A> class prepared_call {
+	napi_value	func, recv;
+	napi_value	argv[sizeof...(A) + 1];
+	bool		fixed[sizeof...(A) + 1] = {};		// slots given with set<I>
+
+	// the slots a call does not set go back to undefined unless fixed, so no handle from an earlier call's scope is passed on
+	// (a slot the call does set holds a handle from its scope, so it is no longer fixed)
+	template<size_t...I, typename...X> void set_leading(std::index_sequence<I...>, X&&...x) {
+		((argv[I] = to_value(nth_t<I, A...>(std::forward<X>(x))), fixed[I] = false), ...);
+		for (size_t i = sizeof...(X); i < sizeof...(A); i++) {
+			if (!fixed[i])
+				argv[i] = undefined;
+		}
+	}
+	napi_value	invoke() {
+		napi_value	result = nullptr;
+		status = napi_call_function(global_env, recv, func, sizeof...(A), argv, &result);
+		return result;
+	}
+
+public:
+	napi_status	status = napi_ok;		// napi_pending_exception once the callback has thrown
+
+	prepared_call(function f, napi_value recv = undefined) : func(f), recv(recv) {
+		for (auto &i : argv)
+			i = undefined;
+	}
+	// looks the method up once; obj is the receiver
+	prepared_call(object obj, const char *method) : prepared_call(function(value(obj[method])), obj) {}
+
+	bool	ok()	const	{ return status == napi_ok; }
+
+	// sets a slot that stays put across calls; put such slots last, and set them in a scope that outlives the loop
+	template<size_t I> void	set(nth_t<I, A...> x)	{ argv[I] = to_value(x); fixed[I] = true; }
+
+	// sets the first sizeof...(X) slots, calls, and converts the result to R before the call's scope closes
+	template<typename R = void, typename...X> R	call(X&&...x) {
+		static_assert(sizeof...(X) <= sizeof...(A), "too many arguments");
+		if constexpr (std::is_base_of_v<value, R>) {
+			escapable_scope	s;
+			set_leading(std::index_sequence_for<X...>(), std::forward<X>(x)...);
+			return R(s.escape(invoke()));
+		} else {
+			scope	s;
+			set_leading(std::index_sequence_for<X...>(), std::forward<X>(x)...);
+			auto	result = invoke();
+			if constexpr (!std::is_void_v<R>)
+				return ok() ? R(from_value<R>(result)) : R();
+		}
+	}
+	value	operator()(A...args)	{ return call<value>(args...); }
+
+	// batch mode: one call per chunk of items instead of one per item
+	// the callback gets (items, offset), with items copied into a TypedArray (or an array for other element types)
+	// done(result, offset) sees each chunk's result inside the chunk's scope; returns false if a call threw
+	template<typename T, typename F> bool	batch(range<T*> items, size_t chunk, F &&done) {
+		chunk = max(chunk, size_t(1));
+		for (size_t offset = 0; offset < items.size() && ok(); offset += chunk) {
+			scope	s;
+			auto	part	= range<T*>(items.begin() + offset, items.begin() + min(offset + chunk, items.size()));
+			napi_value	args[] = {chunk_value(part), number(double(offset))};
+			napi_value	result;
+			status = napi_call_function(global_env, recv, func, 2, args, &result);
+			if (ok())
+				done(value(result), offset);
+		}
+		return ok();
+	}
+
+private:
+	template<typename T> static napi_value	chunk_value(range<T*> part) {
+		if constexpr (int(typedarray_type<remove_const_t<T>>) >= 0) {
+			return to_value(part);
+		} else {
+			array	a(part.size());
+			for (uint32_t i = 0; i < part.size(); i++)
+				a[i] = to_value(part[i]);
+			return a;
+		}
+	}
+};
+
+template<typename...A> prepared_call<A...> prepare(function f, napi_value recv = undefined) { return {f, recv}; }
+
 //-----------------------------------------------------------------------------
 //	classes
 //-----------------------------------------------------------------------------
@@ -912,27 +2659,157 @@ public:
 template<typename T> class wrapped : public object {
 	static void finalize(node_api_nogc_env env, void* data, void* hint) {
 		delete static_cast<T*>(data);
+		leaks::add(leaks::wrapped, -1);
 	};
 public:
 	explicit wrapped(napi_value v)		: object(v) {}
 	wrapped(T *native)					: object()	{
-		napi_wrap(global_env, v, native, finalize, nullptr, nullptr);
 		setNamedProperty("__proto__", Class<T>::prototype());
+		// a class with shared fields keeps its instances inside an ArrayBuffer, so the native object is moved in there
+		if constexpr (std::is_move_constructible_v<T> && shared_layout<T>::fits) {
+			if (shared_layout<T>::used) {
+				shared_layout<T>::construct(v, [native](void *p) { return new(p) T(std::move(*native)); });
+				delete native;
+				return;
+			}
+		}
+		if (napi_wrap(global_env, v, native, finalize, nullptr, nullptr) == napi_ok)
+			leaks::add(leaks::wrapped, 1);
 	}
 	wrapped(napi_value v, T *native)	: object(v) {
-		napi_wrap(global_env, v, native, finalize, nullptr, nullptr);
+		if (napi_wrap(global_env, v, native, finalize, nullptr, nullptr) == napi_ok)
+			leaks::add(leaks::wrapped, 1);
 	}
 	T*	get() 			const { return (T*)global_env.api<napi_unwrap>()(v); }
-	T*	detach() 		const { return (T*)global_env.api<napi_remove_wrap>()(v); }
+	T*	detach() 		const {
+		// an instance with shared fields does not own a heap object to give up: the caller gets one moved out of the buffer, and the moved-from original goes with the instance
+		if (shared_layout<T>::used) {
+			if constexpr (std::is_move_constructible_v<T> && shared_layout<T>::fits) {
+				if (auto p = get())
+					return new T(std::move(*p));
+			}
+			return nullptr;
+		}
+		auto p = (T*)global_env.api<napi_remove_wrap>()(v);
+		if (p)
+			leaks::add(leaks::wrapped, -1);
+		return p;
+	}
 	T&	operator*()		const { return *get(); }
 	T*	operator->()	const { return get(); }
 	template<typename X> decltype(auto)	operator->*(X T::*x) const { return get()->*x; }
 };
 
-template<typename T, typename...A> struct ClassDefinition {
+//-----------------------------------------------------------------------------
+//	shared fields - scalar fields that JS reads and writes in the native object's own memory
+//	instances of a class with shared fields are built inside an ArrayBuffer; each instance holds a TypedArray over it per element type,
+//	and the prototype gets plain JS accessors (generated once per class) that index those views, so field access never crosses into native code
+//-----------------------------------------------------------------------------
+
+struct shared_field {
 	const char				*name;
-	range<const property*>	properties;
-	ClassDefinition(const char	*name, std::initializer_list<property> properties) : name(name), properties(properties.begin(), properties.end()) {}
+	uint32_t				offset;
+	napi_typedarray_type	type;
+	uint8_t					size;
+	bool					boolean;
+	bool					readonly;
+	property_fields			accessors;		// used instead if the field is not aligned within the class
+
+	template<auto F, typename X> shared_field(::field<F, X> f) : name(f.name), accessors(property_maker<X>::template make<F>()) {
+		typedef type_t<T_member_class<X>>					C;
+		typedef remove_const_t<deref_t<X>>					T;
+		typedef if_t<std::is_same_v<T, bool>, uint8_t, T>	E;
+		static_assert(int(typedarray_type<E>) >= 0 && !std::is_same_v<E, uint8_clamped>, "shared fields must be numbers or bools");
+		alignas(C) static byte	dummy[sizeof(C)];
+		offset		= uint32_t((byte*)&(((C*)dummy)->*F) - dummy);
+		type		= typedarray_type<E>;
+		size		= sizeof(E);
+		boolean		= std::is_same_v<T, bool>;
+		readonly	= std::is_const_v<deref_t<X>>;
+	}
+};
+
+// per class state: the symbols each instance stores its views under (null for element types no field uses)
+template<typename T> struct shared_layout {
+	static constexpr int	num_types	= napi_biguint64_array + 1;
+	static inline NODE_PER_ENV napi_ref	symbols[num_types];		// live as long as the class, so never deleted
+	static inline NODE_PER_ENV bool		used;					// set once the class is defined with shared fields
+	static constexpr bool				fits	= alignof(T) <= 16;	// ArrayBuffer memory is only 16 byte aligned, so more aligned classes keep native accessors
+
+	// the accessors are compiled once into a function and applied to the prototype
+	static void	define(napi_value prototype, range<const shared_field*> fields) {
+		static_assert(fits, "ArrayBuffer memory is only 16 byte aligned");
+		used	= true;
+		std::string	src		= "(function(proto, s) {";
+		for (auto &f : fields) {
+			if (f.offset % f.size == 0 && !symbols[f.type]) {
+				symbols[f.type] = ref(symbol(string("shared view"))).detach();
+				src += "const s" + std::to_string(f.type) + " = s[" + std::to_string(f.type) + "];";
+			}
+		}
+		src += "Object.defineProperties(proto, {";
+		for (auto &f : fields) {
+			if (f.offset % f.size) {
+				property	p(f.name, f.accessors);
+				napi_define_properties(global_env, prototype, 1, &p);
+				continue;
+			}
+			auto	elem	= "this[s" + std::to_string(f.type) + "][" + std::to_string(f.offset / f.size) + "]";
+			src += std::string("\"") + f.name + "\": {configurable: true, get() { return " + (f.boolean ? "!!" : "") + elem + "; }";
+			if (!f.readonly)
+				src += ", set(v) { " + elem + " = " + (f.boolean ? "v ? 1 : 0" : "v") + "; }";
+			src += "},";
+		}
+		src += "});})";
+
+		array	syms(num_types);
+		for (uint32_t i = 0; i < num_types; i++)
+			syms[i] = symbols[i] ? value(global_env.api<napi_get_reference_value>()(symbols[i])) : value(undefined);
+		function(global_env.run_script(string(src.c_str())))(value(prototype), syms);
+	}
+
+	template<typename M> static napi_value	construct(napi_value obj, M &&make) {
+		static_assert(fits, "ArrayBuffer memory is only 16 byte aligned");
+		static const uint8_t sizes[num_types] = {1, 1, 1, 2, 2, 4, 4, 4, 8, 8, 8};
+		void*		data;
+		napi_value	buffer;
+		if (napi_create_arraybuffer(global_env, sizeof(T), &data, &buffer) != napi_ok)
+			return nullptr;
+		T*	native = make(data);
+
+		// the buffer is pinned until the wrap finalizer has run, so the native object's memory outlives the JS views and the destructor
+		napi_ref	pin;
+		napi_create_reference(global_env, buffer, 1, &pin);
+		napi_wrap(global_env, obj, native, [](node_api_nogc_env env, void *data, void *pin) {
+			if constexpr (!std::is_trivially_destructible_v<T>)
+				((T*)data)->~T();
+			napi_delete_reference((napi_env)env, (napi_ref)pin);
+			leaks::add(leaks::wrapped, -1);
+		}, pin, nullptr);
+		leaks::add(leaks::wrapped, 1);
+
+		// the views are fixed to the instance: not writable, enumerable or configurable, so script cannot swap or delete them
+		napi_property_descriptor	views[num_types];
+		size_t						num_views = 0;
+		for (int i = 0; i < num_types; i++) {
+			if (symbols[i]) {
+				napi_value	sym, view;
+				napi_get_reference_value(global_env, symbols[i], &sym);
+				napi_create_typedarray(global_env, napi_typedarray_type(i), sizeof(T) / sizes[i], buffer, 0, &view);
+				views[num_views++] = {nullptr, sym, nullptr, nullptr, nullptr, view, napi_default, nullptr};
+			}
+		}
+		napi_define_properties(global_env, obj, num_views, views);
+		return obj;
+	}
+};
+
+template<typename T, typename...A> struct ClassDefinition {
+	const char					*name;
+	range<const property*>		properties;
+	range<const shared_field*>	shared;
+	ClassDefinition(const char	*name, std::initializer_list<property> properties, std::initializer_list<shared_field> shared = {})
+		: name(name), properties(properties.begin(), properties.end()), shared(shared.begin(), shared.end()) {}
 };
 
 struct Constructor : object {
@@ -940,7 +2817,27 @@ struct Constructor : object {
 	Constructor(string_param name, callback constructor, range<const property*> properties) {
 		global_env.api<napi_define_class>()(name.utf8, name.length, constructor.cb, constructor.data, properties.size(), properties.begin(), &v);
 	}
-	template<typename T, typename...A> Constructor(const ClassDefinition<T, A...> &def) : Constructor(def.name, callback::make_constructor<T, A...>(), def.properties) {}
+	template<typename T, typename...A> Constructor(const ClassDefinition<T, A...> &def) : Constructor(def.name, make_constructor<T, A...>(def), def.properties) {
+		if (def.shared.empty())
+			return;
+		if constexpr (shared_layout<T>::fits) {
+			shared_layout<T>::define(prototype(), def.shared);
+		} else {
+			// too aligned to live in an ArrayBuffer, so every shared field falls back to its native accessor
+			auto	proto = prototype();
+			for (auto &f : def.shared) {
+				property	p(f.name, f.accessors);
+				napi_define_properties(global_env, proto, 1, &p);
+			}
+		}
+	}
+	template<typename T, typename...A> static callback	make_constructor(const ClassDefinition<T, A...> &def) {
+		if constexpr (shared_layout<T>::fits) {
+			if (!def.shared.empty())
+				return callback::make_shared_constructor<T, A...>();
+		}
+		return callback::make_constructor<T, A...>();
+	}
 
 	napi_value	prototype()	{ return getNamedProperty("prototype");}
 
@@ -958,7 +2855,8 @@ struct Constructor : object {
 template<typename T> Constructor define();
 
 template<typename T> struct Class {
-	static auto		constructor()			{ static refT<Constructor> c = define<T>(); return *c; }
+	// never deleted: it lives as long as the env, and a worker's env is gone before its thread_locals are destroyed
+	static auto		constructor()			{ static NODE_PER_ENV napi_ref c = ref(define<T>()).detach(); return Constructor(global_env.api<napi_get_reference_value>()(c)); }
 	static auto 	prototype()				{ return constructor().prototype(); }
 	static bool 	isInstance(value inst)	{ return constructor().isInstance(inst); }
 	template<typename...A> static auto newInstance(A...args) { return wrapped<T>(constructor().newInstance(args...)); }
@@ -966,36 +2864,193 @@ template<typename T> struct Class {
 };
 
 //-----------------------------------------------------------------------------
-//	scopes
+//	lazy exports - each export starts as an accessor on exports; the first read creates it and replaces the accessor with a plain value
+//	so a process only pays napi_create_function/napi_define_class for what it touches
+//	Node::define_exports(exports, {
+//		Node::lazy_export::function<Compress>("compress"),
+//		Node::lazy_export::constructor<Archive>("Archive"),
+//	});
 //-----------------------------------------------------------------------------
 
-class scope {
-	napi_handle_scope	v;
-public:
-	scope()		{ global_env.api<napi_open_handle_scope>()(&v); }
-	~scope()	{ napi_close_handle_scope(global_env, v); }
+#ifndef NODE_LAZY_EXPORTS
+#define NODE_LAZY_EXPORTS	1		// 0 creates everything in define_exports, still timed, for comparison
+#endif
+
+// creation cost of one export, summed over every env that has created it
+struct export_cost {
+	const char				*name;
+	napi_value				(*make)(const char *name);
+	std::atomic<uint64_t>	created{0}, ns{0};
+	export_cost				*next = nullptr;
+
+	export_cost(const char *name, napi_value (*make)(const char*)) : name(name), make(make) {
+		next = all().load(std::memory_order_relaxed);
+		while (!all().compare_exchange_weak(next, this))
+			;
+	}
+	static std::atomic<export_cost*>&	all()	{ static std::atomic<export_cost*> a{nullptr}; return a; }
+
+	napi_value	create() {
+		auto	t	= metrics::now();
+		auto	v	= make(name);
+		// workers can create the same export at once, so these need real atomic adds
+		ns.fetch_add(metrics::now() - t, std::memory_order_relaxed);
+		created.fetch_add(1, std::memory_order_relaxed);
+		return v;
+	}
 };
 
-class escapable_scope {
-	napi_escapable_handle_scope	v;
-public:
-	escapable_scope()	{ global_env.api<napi_open_escapable_handle_scope>()(&v); }
-	~escapable_scope()	{ napi_close_escapable_handle_scope(global_env, v); }
+struct lazy_export {
+	export_cost	*cost;
 
-	value escape(value escapee) {
-		return global_env.api<napi_escape_handle>()(v, escapee);
+	template<auto &F> static lazy_export	function(const char *name) {
+		static export_cost	c(name, [](const char *name) -> napi_value { return Node::function::make<F>(name); });
+		return {&c};
+	}
+	template<typename T> static lazy_export	constructor(const char *name) {
+		static export_cost	c(name, [](const char*) -> napi_value { return Class<T>::constructor(); });
+		return {&c};
+	}
+	// any other value: napi_value F()
+	template<napi_value (*F)()> static lazy_export	value(const char *name) {
+		static export_cost	c(name, [](const char*) { return F(); });
+		return {&c};
 	}
-};
 
-class callback_scope {
-	napi_callback_scope v;
-public:
-	callback_scope(napi_async_context context, napi_value async_resource)	{
-        global_env.api<napi_open_callback_scope>()(async_resource, context, &v);
-    }
-	~callback_scope()	{ napi_close_callback_scope(global_env, v); }
+	static void	replace(napi_env env, napi_value obj, const char *name, napi_value v) {
+		napi_property_descriptor	d = {name, nullptr, nullptr, nullptr, nullptr, v, napi_property_attributes(napi_writable | napi_enumerable | napi_configurable), nullptr};
+		napi_define_properties(env, obj, 1, &d);
+	}
+	// load(exports, i): called by the generated getter for the ith export of one define_exports call
+	static napi_value	load(napi_env env, napi_callback_info info) {
+		size_t		argc = 2;
+		napi_value	argv[2];
+		void*		data;
+		napi_get_cb_info(env, info, &argc, argv, nullptr, &data);
+		save		s(global_env.env, env);
+		uint32_t	i;
+		napi_get_value_uint32(env, argv[1], &i);
+		auto	c	= ((export_cost**)data)[i];
+		auto	v	= c->create();
+		if (v)
+			replace(env, argv[0], c->name, v);
+		return v;
+	}
 };
 
+// napi accessors cost a native function template each, so the getters are plain JS closures over one native loader
+inline bool	define_exports(napi_value exports, std::initializer_list<lazy_export> list, bool lazy = NODE_LAZY_EXPORTS) {
+	if (!lazy) {
+		alloc_block<napi_property_descriptor>	props(list.size());
+		auto	d = props.begin();
+		for (auto &i : list)
+			*d++ = {i.cost->name, nullptr, nullptr, nullptr, nullptr, i.cost->create(), napi_property_attributes(napi_writable | napi_enumerable | napi_configurable), nullptr};
+		return napi_define_properties(global_env, exports, props.size(), props.begin()) == napi_ok;
+	}
+
+	auto	costs	= new export_cost*[list.size()];
+	array	names(list.size());
+	uint32_t	n = 0;
+	for (auto &i : list) {
+		costs[n] = i.cost;
+		names[n++] = string(i.cost->name);
+	}
+	function	load("load", callback(lazy_export::load, costs));
+	napi_add_finalizer(global_env, load, costs, [](napi_env, void *data, void*) { delete[] (export_cost**)data; }, nullptr, nullptr);
+
+	static const char	src[] =
+		"(function(exports, load, names) {"
+			"for (let i = 0; i < names.length; i++) {"
+				"const name = names[i];"
+				"Object.defineProperty(exports, name, {"
+					"get() { return load(this, i); },"
+					"set(v) { Object.defineProperty(this, name, {value: v, writable: true, enumerable: true, configurable: true}); },"
+					"enumerable: true, configurable: true"
+				"});"
+			"}"
+		"})";
+	return !!function(global_env.run_script(string(src)))(value(exports), load, names);
+}
+
+// one line per export created so far, most expensive first
+inline std::string	export_report() {
+	std::vector<export_cost*>	all;
+	for (auto c = export_cost::all().load(); c; c = c->next)
+		all.push_back(c);
+	for (size_t i = 1; i < all.size(); i++)
+		for (size_t j = i; j > 0 && all[j - 1]->ns < all[j]->ns; j--)
+			swap(all[j - 1], all[j]);
+
+	std::string	r;
+	char		line[256];
+	uint64_t	total = 0, pending = 0;
+	snprintf(line, sizeof(line), "%-40s %10s %12s %10s\n", "export", "created", "total us", "us each");
+	r += line;
+	for (auto c : all) {
+		uint64_t	n = c->created, ns = c->ns;
+		total += ns;
+		if (!n) {
+			++pending;
+			continue;
+		}
+		snprintf(line, sizeof(line), "%-40s %10llu %12.1f %10.2f\n", c->name, (unsigned long long)n, ns / 1e3, ns / 1e3 / n);
+		r += line;
+	}
+	snprintf(line, sizeof(line), "%llu us creating exports; %llu never touched\n", (unsigned long long)(total / 1000), (unsigned long long)pending);
+	r += line;
+	return r;
+}
+
+//-----------------------------------------------------------------------------
+//	metrics from JS - bind these to read and control the counters
+//-----------------------------------------------------------------------------
+
+namespace metrics {
+// {name: {calls, totalMs, maxMs, meanUs, slow, histogram}} for every binding called so far; histogram[i] counts calls in bucket i
+inline object	stats() {
+	object	r;
+	for (auto s = site::all().load(); s; s = s->next) {
+		auto	t = s->read();
+		if (!t.calls)
+			continue;
+		array	hist(buckets);
+		for (uint32_t i = 0; i < buckets; i++)
+			hist[i] = number(double(t.hist[i]));
+		r[s->name] = object::make(
+			"calls",	double(t.calls),
+			"totalMs",	t.total / 1e6,
+			"maxMs",	t.max / 1e6,
+			"meanUs",	t.total / 1e3 / t.calls,
+			"slow",		double(t.slow),
+			"histogram", hist
+		);
+	}
+	return r;
+}
+inline void		reset()					{ for (auto s = site::all().load(); s; s = s->next) s->reset(); }
+// {name: {created, totalUs}} for every export registered with define_exports
+inline object	export_costs() {
+	object	r;
+	for (auto c = export_cost::all().load(); c; c = c->next)
+		r[c->name] = object::make("created", double(c->created), "totalUs", c->ns / 1e3);
+	return r;
+}
+// 0 turns the watchdog off
+inline void		set_budget(double ms)	{ budget() = uint64_t(ms * 1e6); }
+} // namespace metrics
+
+namespace leaks {
+// {enabled, refs, scopes, wrapped}; compare before and after a loop of calls, with a GC in between so finalizers have run
+inline object	stats() {
+	return object::make(
+		"enabled",	enabled,
+		"refs",		double(get(refs)),
+		"scopes",	double(get(scopes)),
+		"wrapped",	double(get(wrapped))
+	);
+}
+} // namespace leaks
+
 //-----------------------------------------------------------------------------
 //	etc
 //-----------------------------------------------------------------------------
@@ -0,0 +1,232 @@
+#pragma once
+#include "node.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <deque>
+
+//-----------------------------------------------------------------------------
+//	thread_pool - persistent workers that split index ranges into chunks
+//	the submitting thread works on its own job too, so a job never waits on an idle pool
+//-----------------------------------------------------------------------------
+
+class thread_pool {
+	struct job {
+		size_t				n, chunks;
+		std::atomic<size_t>	next{0};
+		int					users = 0;		// workers currently holding the job; guarded by the pool mutex
+		job(size_t n, size_t chunks) : n(n), chunks(chunks) {}
+		virtual void run(size_t i, size_t begin, size_t end) = 0;
+		bool work() {
+			size_t i = next++;
+			if (i >= chunks)
+				return false;
+			run(i, n * i / chunks, n * (i + 1) / chunks);
+			return true;
+		}
+	};
+	template<typename F> struct job_of : job {
+		F	&f;
+		job_of(size_t n, size_t chunks, F &f) : job(n, chunks), f(f) {}
+		void run(size_t i, size_t begin, size_t end) override { f(i, begin, end); }
+	};
+
+	std::mutex					mutex;
+	std::condition_variable		wake, finished;
+	std::deque<job*>			jobs;
+	std::vector<std::thread>	threads;
+	bool						quit = false;
+
+	void	worker() {
+		std::unique_lock<std::mutex>	lock(mutex);
+		for (;;) {
+			wake.wait(lock, [this] { return quit || !jobs.empty(); });
+			if (quit)
+				return;
+			auto	j = jobs.front();
+			++j->users;
+			lock.unlock();
+			while (j->work())
+				;
+			lock.lock();
+			if (!jobs.empty() && jobs.front() == j)
+				jobs.pop_front();
+			if (!--j->users)
+				finished.notify_all();
+		}
+	}
+
+public:
+	thread_pool(unsigned n) {
+		for (unsigned i = 0; i < n; i++)
+			threads.emplace_back([this] { worker(); });
+	}
+	~thread_pool() {
+		{
+			std::lock_guard<std::mutex>	lock(mutex);
+			quit = true;
+		}
+		wake.notify_all();
+		for (auto &t : threads)
+			t.join();
+	}
+
+	static thread_pool&	get()	{ static thread_pool pool(max(std::thread::hardware_concurrency(), 2u) - 1); return pool; }
+
+	size_t	concurrency()	const	{ return threads.size() + 1; }
+
+	// enough chunks to balance uneven work, none smaller than grain elements
+	size_t	chunk_count(size_t n, size_t grain) const {
+		return clamp((n + grain - 1) / max(grain, size_t(1)), 1, concurrency() * 4);
+	}
+
+	// f(chunk, begin, end) for chunk in [0, chunks); returns when every chunk has finished
+	template<typename F> void run(size_t n, size_t chunks, F &&f) {
+		job_of<F>	j(n, chunks, f);
+		if (chunks > 1) {
+			std::lock_guard<std::mutex>	lock(mutex);
+			jobs.push_back(&j);
+			wake.notify_all();
+		}
+		while (j.work())
+			;
+		if (chunks > 1) {
+			std::unique_lock<std::mutex>	lock(mutex);
+			for (auto i = jobs.begin(); i != jobs.end(); ++i) {
+				if (*i == &j) {
+					jobs.erase(i);
+					break;
+				}
+			}
+			finished.wait(lock, [&j] { return j.users == 0; });
+		}
+	}
+
+	// f(begin, end)
+	template<typename F> void parallel_for(size_t n, size_t grain, F &&f) {
+		run(n, chunk_count(n, grain), [&f](size_t, size_t begin, size_t end) { f(begin, end); });
+	}
+};
+
+namespace Node {
+
+//-----------------------------------------------------------------------------
+//	pinned_array - keeps a TypedArray's memory valid while background threads use it
+//	pinning holds a strong reference, so the buffer cannot be collected; JS can still write to it (or transfer it away)
+//	transfer copies the contents out and detaches the original so JS cannot observe or disturb the job;
+//	only a view of a whole ArrayBuffer is detached - a subarray, pooled Buffer or slab slice shares its buffer with other views, so that is just copied;
+//	result() then hands the native copy back to JS as a new TypedArray
+//-----------------------------------------------------------------------------
+
+template<typename T> class pinned_array {
+	refT<TypedArray<T>>	keep;
+	alloc_block<T>		owned;
+public:
+	range<T*>			data;
+
+	pinned_array(TypedArray<T> a, bool transfer = false) : data(TypedArray<T>::is(a).native()) {
+		if (transfer) {
+			owned = alloc_block<T>(data.size());
+			copyn(owned.begin(), data.begin(), data.size());
+			data = owned;
+		#if NAPI_VERSION >= 7
+			size_t	byte_offset;
+			auto	buffer = a.getArrayBuffer(byte_offset);
+			if (byte_offset == 0 && buffer.native().size() == data.size() * sizeof(T))
+				buffer.detach();
+		#endif
+		} else {
+			keep = refT<TypedArray<T>>(a);
+		}
+	}
+	pinned_array(pinned_array &&b) = default;
+
+	// main thread only
+	TypedArray<T>	result() {
+		if (owned) {
+			size_t	n = owned.size();
+			return adopt_typed(owned.detach(), n, finalizer([](node_api_nogc_env, void *data, void*) { free(data); }, nullptr));
+		}
+		return *keep;
+	}
+};
+
+static constexpr size_t parallel_grain = 16384;
+
+// f(range<T*> chunk, size_t offset) runs on the pool; the promise resolves to the array (or its transferred copy)
+template<typename T, typename F> Promise parallel_for(TypedArray<T> a, F &&f, bool transfer = false, size_t grain = parallel_grain) {
+	Promise	p;
+	pinned_array<T>	pin(a, transfer);
+	auto	data = pin.data;
+	async_work("parallel_for",
+		[data, grain, f = std::forward<F>(f)]() {
+			thread_pool::get().parallel_for(data.size(), grain, [&](size_t begin, size_t end) {
+				f(range<T*>(data.begin() + begin, data.begin() + end), begin);
+			});
+		},
+		[p, pin = std::move(pin)](napi_status status) mutable {
+			if (status == napi_ok)
+				p.resolve(pin.result());
+			else
+				p.reject(error("ERR_PARALLEL", "parallel_for did not complete"));
+		}
+	);
+	return p;
+}
+
+// result[i] = f(a[i]) into a new TypedArray<D>
+template<typename D, typename S, typename F> Promise parallel_map(TypedArray<S> a, F &&f, bool transfer = false, size_t grain = parallel_grain) {
+	Promise	p;
+	pinned_array<S>	src(a, transfer);
+	D*		d;
+	auto	n	= src.data.size();
+	pinned_array<D>	dst(TypedArray<D>(n, &d));
+	auto	s	= src.data;
+	async_work("parallel_map",
+		[s, d, grain, f = std::forward<F>(f)]() {
+			thread_pool::get().parallel_for(s.size(), grain, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++)
+					d[i] = f(s[i]);
+			});
+		},
+		[p, src = std::move(src), dst = std::move(dst)](napi_status status) mutable {
+			if (status == napi_ok)
+				p.resolve(dst.result());
+			else
+				p.reject(error("ERR_PARALLEL", "parallel_map did not complete"));
+		}
+	);
+	return p;
+}
+
+// each chunk folds to f(range<const T*>) -> R, partials are folded in order with combine(R, R) -> R, starting from init
+template<typename T, typename R, typename F, typename C> Promise parallel_reduce(TypedArray<T> a, R init, F &&f, C &&combine, size_t grain = parallel_grain) {
+	Promise	p;
+	pinned_array<T>	pin(a);
+	auto	data = pin.data;
+	async_work("parallel_reduce",
+		[data, init, grain, f = std::forward<F>(f), combine = std::forward<C>(combine)]() {
+			auto&	pool	= thread_pool::get();
+			auto	chunks	= pool.chunk_count(data.size(), grain);
+			std::vector<R>	partial(chunks, init);
+			pool.run(data.size(), chunks, [&](size_t i, size_t begin, size_t end) {
+				partial[i] = f(range<const T*>(data.begin() + begin, data.begin() + end));
+			});
+			R	r = init;
+			for (auto &i : partial)
+				r = combine(r, i);
+			return r;
+		},
+		[p, pin = std::move(pin)](napi_status status, R result) {
+			if (status == napi_ok)
+				p.resolve(result);
+			else
+				p.reject(error("ERR_PARALLEL", "parallel_reduce did not complete"));
+		}
+	);
+	return p;
+}
+
+}	// namespace Node
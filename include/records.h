@@ -0,0 +1,248 @@
+#pragma once
+#include "node.h"
+
+//-----------------------------------------------------------------------------
+//	binary record layouts
+//
+//	struct Sample { uint8_t kind; uint16_t channel; uint32_t id; double value; };
+//	using SampleWire = Node::record_layout<byte_order::little,
+//		field<&Sample::kind>, wire<&Sample::channel, big_endian<uint16_t>>, pad<1>, field<&Sample::id>, field<&Sample::value>
+//	>;
+//	auto samples = SampleWire::decode(buffer);		// alloc_block<Sample>
+//-----------------------------------------------------------------------------
+
+enum class byte_order { little, big, host = host_big_endian ? big : little };
+
+template<auto F, typename W = deref_t<decltype(F)>> struct wire {};	// member F stored as W (a plain type uses the record's byte order)
+template<size_t N> struct pad {};										// N unused bytes
+
+namespace Node {
+
+template<typename W, byte_order O> struct wire_type {
+	typedef W type;
+	static constexpr bool big = O == byte_order::big;
+};
+template<typename T, bool BIG, byte_order O> struct wire_type<endian_t<T, BIG>, O> {
+	typedef T type;
+	static constexpr bool big = BIG;
+};
+
+template<typename M> struct wire_member;
+
+template<auto F, typename W> struct wire_member<wire<F, W>> {
+	typedef type_t<T_member_class<decltype(F)>>	C;
+	typedef deref_t<decltype(F)>				M;
+	static constexpr size_t	size	= sizeof(W);
+	static constexpr bool	column	= true;
+
+	template<byte_order O> using T	= type_t<wire_type<W, O>>;
+
+	template<byte_order O> static void decode(const byte *p, C &c)	{ c.*F = static_cast<M>(load_endian<T<O>>(p, wire_type<W, O>::big)); }
+	template<byte_order O> static void encode(byte *p, const C &c)	{ store_endian(p, static_cast<T<O>>(c.*F), wire_type<W, O>::big); }
+
+	// strided bulk transfer of this member between n wire records and contiguous column storage
+	template<byte_order O> static void gather(T<O> *d, const byte *s, size_t stride, size_t n)	{ load_strided<T<O>, wire_type<W, O>::big>(d, s, stride, n); }
+	template<byte_order O> static void scatter(byte *d, const T<O> *s, size_t stride, size_t n)	{ store_strided<T<O>, wire_type<W, O>::big>(d, s, stride, n); }
+};
+
+template<auto F, typename X> struct wire_member<field<F, X>> : wire_member<wire<F>> {};
+
+template<size_t N> struct wire_member<pad<N>> {
+	typedef void	C;
+	static constexpr size_t	size	= N;
+	static constexpr bool	column	= false;
+	template<byte_order O, typename X> static void decode(const byte *p, X &c)	{}
+	template<byte_order O, typename X> static void encode(byte *p, const X &c)	{ memset(p, 0, N); }
+};
+
+template<typename...M> struct T_record_class;
+template<typename M0, typename...M> struct T_record_class<M0, M...> : if_t<std::is_void_v<typename wire_member<M0>::C>, T_record_class<M...>, T_type<typename wire_member<M0>::C>> {};
+
+template<byte_order O, typename...M> struct record_layout {
+	typedef type_t<T_record_class<M...>>	native;
+	static constexpr size_t	size = (wire_member<M>::size + ...);
+
+	static size_t	count(size_t bytes)					{ return bytes / size; }
+	static void		decode(const byte *p, native &c)	{ ((wire_member<M>::template decode<O>(p, c), p += wire_member<M>::size), ...); }
+	static void		encode(byte *p, const native &c)	{ ((wire_member<M>::template encode<O>(p, c), p += wire_member<M>::size), ...); }
+
+	// batches are bounds checked once up front; returns the number of records transferred
+	static size_t	decode(range<const byte*> src, range<native*> dst) {
+		size_t	n = min(count(src.size()), dst.size());
+		auto	p = src.begin();
+		for (size_t i = 0; i < n; i++, p += size)
+			decode(p, dst[i]);
+		return n;
+	}
+	static size_t	encode(range<const native*> src, range<byte*> dst) {
+		size_t	n = min(count(dst.size()), src.size());
+		auto	p = dst.begin();
+		for (size_t i = 0; i < n; i++, p += size)
+			encode(p, src[i]);
+		return n;
+	}
+
+	static alloc_block<native> decode(range<const byte*> src) {
+		alloc_block<native>	r(count(src.size()));
+		decode(src, r);
+		return r;
+	}
+	// v is an ArrayBuffer, TypedArray (eg. a Buffer) or DataView
+	static alloc_block<native> decode(napi_value v, size_t byte_offset = 0) {
+		auto	data = binary_data(v);
+		return decode(range<const byte*>(data.begin() + min(byte_offset, data.size()), data.end()));
+	}
+	static ArrayBuffer encode(range<const native*> src) {
+		void*		data;
+		ArrayBuffer	buffer(src.size() * size, &data);
+		encode(src, range<byte*>((byte*)data, src.size() * size));
+		return buffer;
+	}
+
+	// columnar mode: each member of n records gathered into its own TypedArray of the wire value type
+	static array	decode_columns(range<const byte*> src) {
+		array	cols;
+		size_t	n		= count(src.size());
+		auto	p		= src.begin();
+		((add_column<M>(cols, p, n), p += wire_member<M>::size), ...);
+		return cols;
+	}
+	static array	decode_columns(napi_value v)	{ return decode_columns(binary_data(v)); }
+	static object	decode_columns(napi_value v, std::initializer_list<const char*> names) {
+		auto	cols	= decode_columns(v);
+		object	obj;
+		uint32_t	i	= 0;
+		for (auto name : names)
+			obj[name] = value(cols[i++]);
+		return obj;
+	}
+
+	// inverse of decode_columns: cols holds one TypedArray per member; records are limited by the shortest column
+	static ArrayBuffer encode_columns(array cols) {
+		size_t	n = ~size_t(0);
+		uint32_t	i = 0;
+		(column_length<M>(cols, i, n), ...);
+		if (n == ~size_t(0))
+			n = 0;
+
+		void*		data;
+		ArrayBuffer	buffer(n * size, &data);
+		auto		p = (byte*)data;
+		i = 0;
+		((put_column<M>(cols, i, p, n), p += wire_member<M>::size), ...);
+		return buffer;
+	}
+
+private:
+	template<typename W> using column_t = typename wire_member<W>::template T<O>;
+
+	template<typename W> static void add_column(array &cols, const byte *p, size_t n) {
+		if constexpr (wire_member<W>::column) {
+			column_t<W>*		d;
+			TypedArray<column_t<W>>	col(n, &d);
+			wire_member<W>::template gather<O>(d, p, size, n);
+			cols.push(col);
+		}
+	}
+	template<typename W> static void column_length(array &cols, uint32_t &i, size_t &n) {
+		if constexpr (wire_member<W>::column)
+			n = min(n, TypedArray<column_t<W>>::is(value(cols[i++])).native().size());
+	}
+	template<typename W> static void put_column(array &cols, uint32_t &i, byte *p, size_t n) {
+		if constexpr (wire_member<W>::column) {
+			wire_member<W>::template scatter<O>(p, TypedArray<column_t<W>>::is(value(cols[i++])).native().begin(), size, n);
+		} else {
+			for (size_t j = 0; j < n; j++, p += size)
+				memset(p, 0, wire_member<W>::size);
+		}
+	}
+};
+
+//-----------------------------------------------------------------------------
+//	columnar export
+//	auto cols = Node::export_columns(rows, field<&Row::id>("id"), field<&Row::price>("price"), field<&Row::name>("name"));
+//	-> {length, id: Uint32Array, price: Float64Array, name: {offsets: Uint32Array, bytes: Uint8Array}}
+//	every column is a view of one ArrayBuffer, so n rows cost a few allocations rather than n objects
+//	string column i is bytes.subarray(offsets[i], offsets[i + 1]), in utf8
+//-----------------------------------------------------------------------------
+
+template<typename X> struct column_member {
+	typedef type_t<T_member_class<X>>	C;
+	typedef remove_const_t<deref_t<X>>	T;
+	typedef if_t<std::is_same_v<T, bool>, uint8_t, T>	E;		// bools are stored as Uint8Array
+	static_assert(int(typedarray_type<E>) >= 0, "column fields must be numbers, bools or strings");
+
+	template<auto F> static bool	fits(range<const C*>)					{ return true; }
+	template<auto F> static size_t	bytes(range<const C*> rows)				{ return rows.size() * sizeof(E); }
+	template<auto F> static void	fill(byte *p, range<const C*> rows)		{ auto d = (E*)p; for (auto &i : rows) *d++ = E(i.*F); }
+	static value					view(ArrayBuffer buffer, size_t offset, size_t n)	{ return TypedArray<E>(buffer, offset, n); }
+};
+
+template<typename X> struct column_text {
+	typedef type_t<T_member_class<X>>	C;
+
+	// the offsets are a Uint32Array, so a column's text must stay under 4GB
+	template<auto F> static bool	fits(range<const C*> rows) {
+		size_t	n = 0;
+		for (auto &i : rows)
+			n += (i.*F).size();
+		return n <= 0xffffffffu;
+	}
+	template<auto F> static size_t	bytes(range<const C*> rows) {
+		size_t	n = (rows.size() + 1) * sizeof(uint32_t);
+		for (auto &i : rows)
+			n += (i.*F).size();
+		return n;
+	}
+	template<auto F> static void	fill(byte *p, range<const C*> rows) {
+		auto	offsets	= (uint32_t*)p;
+		auto	text	= p + (rows.size() + 1) * sizeof(uint32_t);
+		auto	d		= text;
+		for (auto &i : rows) {
+			*offsets++ = uint32_t(d - text);
+			memcpy(d, (i.*F).data(), (i.*F).size());
+			d += (i.*F).size();
+		}
+		*offsets = uint32_t(d - text);
+	}
+	static value					view(ArrayBuffer buffer, size_t offset, size_t n) {
+		auto	offsets = TypedArray<uint32_t>(buffer, offset, n + 1);
+		auto	size	= offsets.native()[n];
+		return object::make("offsets", offsets, "bytes", TypedArray<uint8_t>(buffer, offset + (n + 1) * sizeof(uint32_t), size));
+	}
+};
+
+template<typename X> using column_t = if_t<std::is_same_v<remove_const_t<deref_t<X>>, std::string>, column_text<X>, column_member<X>>;
+
+template<typename C, auto...F, typename...X> object export_columns(range<const C*> rows, field<F, X>...fields) {
+	constexpr size_t	align = 8;
+	if (!(column_t<X>::template fits<F>(rows) && ...)) {
+		napi_throw_range_error(global_env, "ERR_OUT_OF_RANGE", "a string column holds 4GB or more of text");
+		return object(nullptr);
+	}
+	size_t	n		= rows.size();
+	size_t	offsets[sizeof...(F)];
+	size_t	total	= 0, i = 0;
+	((offsets[i++] = total, total = (total + column_t<X>::template bytes<F>(rows) + align - 1) & -align), ...);
+
+	// zeroed, so the padding between columns cannot leak old heap contents through the buffer
+	auto	data	= (byte*)calloc(max(total, align), 1);
+	if (!data) {
+		napi_throw_error(global_env, "ERR_MEMORY_ALLOCATION_FAILED", "no memory for the columns");
+		return object(nullptr);
+	}
+	i = 0;
+	(column_t<X>::template fill<F>(data + offsets[i++], rows), ...);
+	auto	buffer	= adopt_buffer(data, total, finalizer([](node_api_nogc_env, void *data, void*) { free(data); }, nullptr));
+
+	object	obj;
+	obj["length"] = number(double(n));
+	i = 0;
+	((obj[fields.name] = column_t<X>::view(buffer, offsets[i++], n)), ...);
+	return obj;
+}
+template<typename C, auto...F, typename...X> object export_columns(const std::vector<C> &rows, field<F, X>...fields) {
+	return export_columns(range<const C*>(rows.data(), rows.size()), fields...);
+}
+
+}	// namespace Node
@@ -0,0 +1,211 @@
+#pragma once
+#include "node.h"
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <typeinfo>
+
+namespace Node {
+
+//-----------------------------------------------------------------------------
+//	shared<T> - process-wide immutable native objects, keyed by name
+//	every env that loads the addon (the main thread and each worker_thread) gets a handle to the same object, built once by whichever asks first
+//	handles are refcounted across threads; the object is destroyed when the last handle, external or ArrayBuffer view goes, and rebuilt if asked for again
+//	views are external ArrayBuffers over the object's memory: JS must treat them as read only, since every thread sees the same bytes
+//-----------------------------------------------------------------------------
+
+class shared_registry {
+public:
+	struct entry {
+		std::string				name;
+		const std::type_info	*type;
+		std::atomic<int>		refs{1};
+		const void				*object	= nullptr;
+		void					(*destroy)(const void*) = nullptr;
+		bool					ready	= false;	// guarded by the registry mutex
+
+		entry(const char *name, const std::type_info *type) : name(name), type(type) {}
+		void	add_ref()	{ ++refs; }
+		void	release()	{ get().release(this); }
+	};
+
+private:
+	std::mutex								mutex;
+	std::condition_variable					built;
+	std::unordered_map<std::string, entry*>	entries;
+
+	// the registry lock is held for the final decrement, so find() can never revive an entry that is being destroyed
+	void	release(entry *e) {
+		{
+			std::lock_guard<std::mutex>	lock(mutex);
+			if (--e->refs)
+				return;
+			entries.erase(e->name);
+		}
+		if (e->destroy)
+			e->destroy(e->object);
+		delete e;
+	}
+
+public:
+	static shared_registry&	get()	{ static shared_registry r; return r; }
+
+	// a counted reference to a ready entry, or null if there is none (or it holds another type)
+	entry*	find(const char *name, const std::type_info &type) {
+		std::unique_lock<std::mutex>	lock(mutex);
+		for (;;) {
+			auto	i = entries.find(name);
+			if (i == entries.end())
+				return nullptr;
+			auto	e = i->second;
+			if (*e->type != type)
+				return nullptr;
+			if (e->ready) {
+				e->add_ref();
+				return e;
+			}
+			built.wait(lock);
+		}
+	}
+
+	// build() runs outside the lock, once, on the first thread to ask; the others wait for it rather than building their own copy
+	template<typename B> entry*	find_or_build(const char *name, const std::type_info &type, B &&build) {
+		entry	*e;
+		{
+			std::unique_lock<std::mutex>	lock(mutex);
+			for (;;) {
+				auto	i = entries.find(name);
+				if (i == entries.end())
+					break;
+				e = i->second;
+				if (*e->type != type)
+					return nullptr;
+				if (e->ready) {
+					e->add_ref();
+					return e;
+				}
+				built.wait(lock);
+			}
+			e = new entry(name, &type);
+			entries.emplace(e->name, e);
+		}
+
+		bool	ok = build(*e);
+		{
+			std::lock_guard<std::mutex>	lock(mutex);
+			if (ok)
+				e->ready = true;
+			else
+				entries.erase(e->name);
+		}
+		built.notify_all();
+		if (!ok) {
+			delete e;
+			return nullptr;
+		}
+		return e;
+	}
+
+	// name of every live entry with its reference count
+	std::vector<std::pair<std::string, int>>	list() {
+		std::lock_guard<std::mutex>	lock(mutex);
+		std::vector<std::pair<std::string, int>>	r;
+		for (auto &i : entries)
+			r.emplace_back(i.first, i.second->refs.load());
+		return r;
+	}
+};
+
+template<typename T> class shared {
+	typedef shared_registry::entry	entry;
+	entry	*e = nullptr;
+
+	explicit shared(entry *e) : e(e) {}
+
+	static void	release_cb(node_api_nogc_env, void*, void *hint) { ((entry*)hint)->release(); }
+#if NAPI_VERSION >= 8
+	// marks externals made by to_external, so from() never mistakes another addon's external for an entry
+	static constexpr napi_type_tag	tag = {0x6e6f64655f736861, 0x7265645f656e7472};
+#endif
+
+public:
+	shared()	{}
+	shared(const shared &b) : e(b.e)			{ if (e) e->add_ref(); }
+	shared(shared &&b) : e(exchange(b.e, nullptr))	{}
+	~shared()									{ if (e) e->release(); }
+	shared&	operator=(shared b)					{ swap(e, b.e); return *this; }
+
+	// build() may return a T, a T* or a std::unique_ptr<T>; a null pointer means the build failed and the next caller tries again
+	template<typename B> static shared	get(const char *name, B &&build) {
+		return shared(shared_registry::get().find_or_build(name, typeid(T), [&build](entry &e) {
+			const T	*p;
+			if constexpr (std::is_convertible_v<decltype(build()), const T*>)
+				p = build();
+			else if constexpr (std::is_constructible_v<std::unique_ptr<T>, decltype(build())>)
+				p = std::unique_ptr<T>(build()).release();
+			else
+				p = new T(build());
+			if (!p)
+				return false;
+			e.object	= p;
+			e.destroy	= [](const void *p) { delete (const T*)p; };
+			return true;
+		}));
+	}
+	// only an object some thread has already built
+	static shared	find(const char *name) {
+		return shared(shared_registry::get().find(name, typeid(T)));
+	}
+
+	explicit operator bool()	const	{ return !!e; }
+	const T*	get()			const	{ return e ? (const T*)e->object : nullptr; }
+	const T&	operator*()		const	{ return *get(); }
+	const T*	operator->()	const	{ return get(); }
+	const char*	name()			const	{ return e ? e->name.c_str() : nullptr; }
+
+	//-----------------------------------------------------------------------------
+	//	JS handles; each holds its own reference, dropped by its finalizer
+	//-----------------------------------------------------------------------------
+
+	// an external the addon's functions can take back with from()
+	napi_value	to_external() const {
+		if (!e)
+			return nullptr;
+		e->add_ref();
+		napi_value	v = global_env.api<napi_create_external>()(e, release_cb, e);
+	#if NAPI_VERSION >= 8
+		napi_type_tag_object(global_env, v, &tag);
+	#endif
+		return v;
+	}
+	static shared	from(napi_value v) {
+		if (global_env.type(v) != napi_external)
+			return {};
+	#if NAPI_VERSION >= 8
+		bool	tagged = false;
+		if (napi_check_object_type_tag(global_env, v, &tag, &tagged) != napi_ok || !tagged)
+			return {};
+	#endif
+		auto	p = (entry*)global_env.api<napi_get_value_external>()(v);
+		if (!p || *p->type != typeid(T))
+			return {};
+		p->add_ref();
+		return shared(p);
+	}
+
+	// bytes inside the shared object; where external buffers are not allowed this is a private copy
+	ArrayBuffer	buffer(const void *data, size_t size) const {
+		e->add_ref();
+		return adopt_buffer((void*)data, size, finalizer(release_cb, e));
+	}
+	template<typename E> TypedArray<E>	view(range<const E*> r) const {
+		return TypedArray<E>(buffer(r.begin(), r.size() * sizeof(E)), 0, r.size());
+	}
+};
+
+template<typename T> struct node_type<shared<T>> {
+	static napi_value	to_value(const shared<T> &x)	{ return x.to_external(); }
+	static shared<T>	from_value(napi_value v)		{ return shared<T>::from(v); }
+};
+
+}	// namespace Node
@@ -0,0 +1,367 @@
+#pragma once
+#include "base.h"
+#include <limits>
+
+//-----------------------------------------------------------------------------
+//	simd kernels over native ranges
+//	bodies are written once with vector extensions and compiled per instruction set (sse2/avx2/avx-512 on x86)
+//	the instruction set is chosen at runtime from cpuid, and can be lowered with simd::set_isa
+//-----------------------------------------------------------------------------
+
+#if !defined(__GNUC__) && !defined(__clang__)
+#error "simd.h needs gcc/clang vector extensions (clang-cl is fine)"
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SIMD_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace simd {
+
+enum isa { isa_scalar, isa_sse2, isa_avx2, isa_avx512 };
+
+inline isa detect_isa() {
+#ifdef SIMD_X86
+	auto cpuid = [](int leaf, int sub, uint32_t r[4]) {
+	#ifdef _MSC_VER
+		__cpuidex((int*)r, leaf, sub);
+	#else
+		__cpuid_count(leaf, sub, r[0], r[1], r[2], r[3]);
+	#endif
+	};
+	auto xgetbv = []() -> uint64_t {
+	#ifdef _MSC_VER
+		return _xgetbv(0);
+	#else
+		uint32_t lo, hi;
+		__asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+		return (uint64_t(hi) << 32) | lo;
+	#endif
+	};
+
+	uint32_t	r[4];
+	cpuid(0, 0, r);
+	if (r[0] < 7)
+		return isa_sse2;
+
+	cpuid(1, 0, r);
+	bool	osxsave	= r[2] & (1 << 27);
+	bool	avx		= r[2] & (1 << 28);
+	bool	fma		= r[2] & (1 << 12);
+	if (!osxsave || !avx)
+		return isa_sse2;
+
+	auto	xcr0	= xgetbv();
+	cpuid(7, 0, r);
+	if ((xcr0 & 0xe6) == 0xe6 && (r[1] & (1u << 16)) && (r[1] & (1u << 17)) && (r[1] & (1u << 30)) && (r[1] & (1u << 31)))
+		return isa_avx512;	// F + DQ + BW + VL, with opmask and zmm state enabled
+	if ((xcr0 & 0x6) == 0x6 && (r[1] & (1 << 5)) && fma)
+		return isa_avx2;
+	return isa_sse2;
+#else
+	return isa_scalar;
+#endif
+}
+
+inline isa& active_isa()		{ static isa i = detect_isa(); return i; }
+inline isa	get_isa()			{ return active_isa(); }
+// can only lower the instruction set below what the cpu supports
+inline void	set_isa(isa i)		{ active_isa() = ::min(i, detect_isa()); }
+
+template<typename T> using acc_t = if_t<std::is_floating_point<T>::value, double, if_t<is_signed_v<T>, int64_t, uint64_t>>;
+
+//-----------------------------------------------------------------------------
+//	generic bodies; B is the vector width in bytes
+//-----------------------------------------------------------------------------
+
+#define SIMD_INLINE inline __attribute__((always_inline))
+
+template<typename T, int N> struct T_vec { typedef T type __attribute__((vector_size(N * sizeof(T)))); };
+template<typename T, int N> using vec = typename T_vec<T, N>::type;
+
+// vectors are only ever passed by reference: the bodies are compiled without the wider instruction sets enabled,
+// so a wide vector passed or returned by value is an abi change that gcc warns about at every use (and -Wpsabi cannot be silenced for instantiations made after the header)
+template<typename V, typename T> SIMD_INLINE void	vload(V &v, const T *p)			{ memcpy(&v, p, sizeof(v)); }
+template<typename V, typename T> SIMD_INLINE void	vstore(T *p, const V &v)		{ memcpy(p, &v, sizeof(v)); }
+template<typename V, typename T> SIMD_INLINE void	vsplat(V &v, T t)				{ v = V{} + t; }
+
+struct op_add { template<typename V> SIMD_INLINE void operator()(V &a, const V &b) const { a = a + b; } };
+struct op_sub { template<typename V> SIMD_INLINE void operator()(V &a, const V &b) const { a = a - b; } };
+struct op_mul { template<typename V> SIMD_INLINE void operator()(V &a, const V &b) const { a = a * b; } };
+struct op_div { template<typename V> SIMD_INLINE void operator()(V &a, const V &b) const { a = a / b; } };
+struct op_min { template<typename V> SIMD_INLINE void operator()(V &a, const V &b) const { a = b < a ? b : a; } };
+struct op_max { template<typename V> SIMD_INLINE void operator()(V &a, const V &b) const { a = a < b ? b : a; } };
+
+namespace body {
+
+template<typename T, int B> SIMD_INLINE acc_t<T> sum(const T *p, size_t n) {
+	typedef acc_t<T>	A;
+	constexpr int		N = B / sizeof(A);
+	vec<A, N>	s0 = {}, s1 = {};
+	size_t		i = 0;
+	for (; i + N * 2 <= n; i += N * 2) {
+		vec<T, N>	v0, v1;
+		vload(v0, p + i);
+		vload(v1, p + i + N);
+		s0 += __builtin_convertvector(v0, vec<A, N>);
+		s1 += __builtin_convertvector(v1, vec<A, N>);
+	}
+	s0 += s1;
+	A	r = 0;
+	for (int j = 0; j < N; j++)
+		r += s0[j];
+	for (; i < n; i++)
+		r += p[i];
+	return r;
+}
+
+template<typename T, int B> SIMD_INLINE acc_t<T> dot(const T *a, const T *b, size_t n) {
+	typedef acc_t<T>	A;
+	constexpr int		N = B / sizeof(A);
+	vec<A, N>	s0 = {}, s1 = {};
+	size_t		i = 0;
+	for (; i + N * 2 <= n; i += N * 2) {
+		vec<T, N>	a0, b0, a1, b1;
+		vload(a0, a + i);
+		vload(b0, b + i);
+		vload(a1, a + i + N);
+		vload(b1, b + i + N);
+		s0 += __builtin_convertvector(a0, vec<A, N>) * __builtin_convertvector(b0, vec<A, N>);
+		s1 += __builtin_convertvector(a1, vec<A, N>) * __builtin_convertvector(b1, vec<A, N>);
+	}
+	s0 += s1;
+	A	r = 0;
+	for (int j = 0; j < N; j++)
+		r += s0[j];
+	for (; i < n; i++)
+		r += A(a[i]) * A(b[i]);
+	return r;
+}
+
+// n must be non-zero; NaNs are skipped unless they come first
+template<typename T, int B, typename OP> SIMD_INLINE T reduce(const T *p, size_t n, OP op) {
+	constexpr int	N = B / sizeof(T);
+	size_t		i = 0;
+	T			r = p[0];
+	if (n >= N) {
+		vec<T, N>	m, v;
+		vload(m, p);
+		for (i = N; i + N <= n; i += N) {
+			vload(v, p + i);
+			op(m, v);
+		}
+		r = m[0];
+		for (int j = 1; j < N; j++)
+			op(r, T(m[j]));
+	}
+	for (; i < n; i++)
+		op(r, p[i]);
+	return r;
+}
+
+template<typename T, int B, typename OP> SIMD_INLINE void binary(const T *a, const T *b, T *d, size_t n, OP op) {
+	constexpr int	N = B / sizeof(T);
+	size_t		i = 0;
+	for (; i + N <= n; i += N) {
+		vec<T, N>	v, w;
+		vload(v, a + i);
+		vload(w, b + i);
+		op(v, w);
+		vstore(d + i, v);
+	}
+	for (; i < n; i++) {
+		d[i] = a[i];
+		op(d[i], b[i]);
+	}
+}
+
+template<typename T, int B, typename OP> SIMD_INLINE void binary(const T *a, T b, T *d, size_t n, OP op) {
+	constexpr int	N = B / sizeof(T);
+	vec<T, N>	v, vb;
+	vsplat(vb, b);
+	size_t		i = 0;
+	for (; i + N <= n; i += N) {
+		vload(v, a + i);
+		op(v, vb);
+		vstore(d + i, v);
+	}
+	for (; i < n; i++) {
+		d[i] = a[i];
+		op(d[i], b);
+	}
+}
+
+// static_cast semantics: float to int conversions truncate and need in range values
+template<typename S, typename D, int B> SIMD_INLINE void convert(const S *s, D *d, size_t n) {
+	constexpr int	N = B / (sizeof(S) > sizeof(D) ? sizeof(S) : sizeof(D));
+	size_t		i = 0;
+	for (; i + N <= n; i += N) {
+		vec<S, N>	v;
+		vload(v, s + i);
+		vstore(d + i, __builtin_convertvector(v, vec<D, N>));
+	}
+	for (; i < n; i++)
+		d[i] = D(s[i]);
+}
+
+// Uint8ClampedArray semantics: clamp to 0..255 (NaN to 0) and round half to even
+template<typename E, typename V> SIMD_INLINE void clamp_u8(V &x) {
+	V	lo = V{} + E(0), hi = V{} + E(255);
+	x = x > lo ? x : lo;
+	x = x < hi ? x : hi;
+}
+template<typename S, int B> SIMD_INLINE void to_clamped(const S *s, uint8_t *d, size_t n) {
+	constexpr int	N = B / sizeof(S);
+	size_t		i = 0;
+	if constexpr (std::is_floating_point<S>::value) {
+		// adding and removing 2^mantissa_bits rounds to nearest even in the default rounding mode
+		constexpr S	magic = S(1ull << (std::numeric_limits<S>::digits - 1));
+		for (; i + N <= n; i += N) {
+			vec<S, N>	v;
+			vload(v, s + i);
+			clamp_u8<S>(v);
+			vstore(d + i, __builtin_convertvector((v + magic) - magic, vec<uint8_t, N>));
+		}
+		for (; i < n; i++) {
+			S	v = s[i];
+			clamp_u8<S>(v);
+			d[i] = uint8_t((v + magic) - magic);
+		}
+	} else {
+		for (; i + N <= n; i += N) {
+			vec<S, N>	v;
+			vload(v, s + i);
+			clamp_u8<S>(v);
+			vstore(d + i, __builtin_convertvector(v, vec<uint8_t, N>));
+		}
+		for (; i < n; i++) {
+			S	v = s[i];
+			clamp_u8<S>(v);
+			d[i] = uint8_t(v);
+		}
+	}
+}
+
+// inclusive scan; the dependency chain is serial so this is a tight scalar loop in every instruction set
+template<typename T> SIMD_INLINE void prefix_sum(const T *s, T *d, size_t n) {
+	T	t = 0;
+	for (size_t i = 0; i < n; i++)
+		d[i] = t += s[i];
+}
+
+// out of range indices read as 0 (gather) or are dropped (scatter)
+template<typename T> SIMD_INLINE void gather(const T *s, size_t sn, const uint32_t *idx, T *d, size_t n) {
+	for (size_t i = 0; i < n; i++)
+		d[i] = idx[i] < sn ? s[idx[i]] : T(0);
+}
+template<typename T> SIMD_INLINE void scatter(const T *s, const uint32_t *idx, T *d, size_t dn, size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		if (idx[i] < dn)
+			d[idx[i]] = s[i];
+	}
+}
+
+} // namespace body
+
+//-----------------------------------------------------------------------------
+//	per instruction set entry points
+//-----------------------------------------------------------------------------
+
+#define SIMD_KERNELS(NAME, TARGET, BYTES)																												\
+struct NAME {																																			\
+	template<typename T> TARGET static acc_t<T>	sum(const T *p, size_t n)									{ return body::sum<T, BYTES>(p, n); }			\
+	template<typename T> TARGET static acc_t<T>	dot(const T *a, const T *b, size_t n)						{ return body::dot<T, BYTES>(a, b, n); }		\
+	template<typename T, typename OP> TARGET static T	reduce(const T *p, size_t n)						{ return body::reduce<T, BYTES>(p, n, OP()); }	\
+	template<typename T, typename OP> TARGET static void binary(const T *a, const T *b, T *d, size_t n)		{ body::binary<T, BYTES>(a, b, d, n, OP()); }	\
+	template<typename T, typename OP> TARGET static void binary_scalar(const T *a, T b, T *d, size_t n)		{ body::binary<T, BYTES>(a, b, d, n, OP()); }	\
+	template<typename S, typename D> TARGET static void convert(const S *s, D *d, size_t n)					{ body::convert<S, D, BYTES>(s, d, n); }		\
+	template<typename S> TARGET static void		to_clamped(const S *s, uint8_t *d, size_t n)				{ body::to_clamped<S, BYTES>(s, d, n); }		\
+	template<typename T> TARGET static void		prefix_sum(const T *s, T *d, size_t n)						{ body::prefix_sum(s, d, n); }					\
+	template<typename T> TARGET static void		gather(const T *s, size_t sn, const uint32_t *i, T *d, size_t n)	{ body::gather(s, sn, i, d, n); }		\
+	template<typename T> TARGET static void		scatter(const T *s, const uint32_t *i, T *d, size_t dn, size_t n)	{ body::scatter(s, i, d, dn, n); }		\
+};
+
+#ifdef SIMD_X86
+SIMD_KERNELS(k_sse2,	__attribute__((target("sse2"))),								16)
+SIMD_KERNELS(k_avx2,	__attribute__((target("avx2,fma"))),							32)
+SIMD_KERNELS(k_avx512,	__attribute__((target("avx512f,avx512dq,avx512bw,avx512vl"))),	64)
+typedef k_sse2	k_scalar;
+#else
+SIMD_KERNELS(k_scalar,	,	16)		// 16 byte vectors map onto neon/altivec where available
+typedef k_scalar	k_sse2;
+typedef k_scalar	k_avx2;
+typedef k_scalar	k_avx512;
+#endif
+
+#undef SIMD_KERNELS
+
+#define SIMD_DISPATCH(...)	\
+	switch (get_isa()) {							\
+		case isa_avx512:	return k_avx512::__VA_ARGS__;	\
+		case isa_avx2:		return k_avx2::__VA_ARGS__;		\
+		case isa_sse2:		return k_sse2::__VA_ARGS__;		\
+		default:			return k_scalar::__VA_ARGS__;	\
+	}
+
+//-----------------------------------------------------------------------------
+//	public kernels
+//-----------------------------------------------------------------------------
+
+template<typename T> acc_t<T> sum(range<const T*> a) {
+	SIMD_DISPATCH(template sum<T>(a.begin(), a.size()));
+}
+template<typename T> acc_t<T> dot(range<const T*> a, range<const T*> b) {
+	SIMD_DISPATCH(template dot<T>(a.begin(), b.begin(), ::min(a.size(), b.size())));
+}
+template<typename T> T min(range<const T*> a) {
+	if (a.empty())
+		return std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+	SIMD_DISPATCH(template reduce<T, op_min>(a.begin(), a.size()));
+}
+template<typename T> T max(range<const T*> a) {
+	if (a.empty())
+		return std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+	SIMD_DISPATCH(template reduce<T, op_max>(a.begin(), a.size()));
+}
+
+// d = a op b over the shortest of the three
+template<typename OP, typename T> void binary(range<const T*> a, range<const T*> b, range<T*> d) {
+	SIMD_DISPATCH(template binary<T, OP>(a.begin(), b.begin(), d.begin(), ::min(::min(a.size(), b.size()), d.size())));
+}
+template<typename OP, typename T> void binary(range<const T*> a, T b, range<T*> d) {
+	SIMD_DISPATCH(template binary_scalar<T, OP>(a.begin(), b, d.begin(), ::min(a.size(), d.size())));
+}
+template<typename T> void add(range<const T*> a, range<const T*> b, range<T*> d)	{ binary<op_add>(a, b, d); }
+template<typename T> void sub(range<const T*> a, range<const T*> b, range<T*> d)	{ binary<op_sub>(a, b, d); }
+template<typename T> void mul(range<const T*> a, range<const T*> b, range<T*> d)	{ binary<op_mul>(a, b, d); }
+template<typename T> void div(range<const T*> a, range<const T*> b, range<T*> d)	{ static_assert(std::is_floating_point<T>::value, "integer division is not vectorised"); binary<op_div>(a, b, d); }
+template<typename T> void add(range<const T*> a, T b, range<T*> d)					{ binary<op_add>(a, b, d); }
+template<typename T> void mul(range<const T*> a, T b, range<T*> d)					{ binary<op_mul>(a, b, d); }
+
+template<typename S, typename D> void convert(range<const S*> s, range<D*> d) {
+	SIMD_DISPATCH(template convert<S, D>(s.begin(), d.begin(), ::min(s.size(), d.size())));
+}
+template<typename S> void to_clamped(range<const S*> s, range<uint8_t*> d) {
+	SIMD_DISPATCH(template to_clamped<S>(s.begin(), d.begin(), ::min(s.size(), d.size())));
+}
+template<typename T> void prefix_sum(range<const T*> s, range<T*> d) {
+	SIMD_DISPATCH(template prefix_sum<T>(s.begin(), d.begin(), ::min(s.size(), d.size())));
+}
+// d[i] = s[idx[i]]
+template<typename T> void gather(range<const T*> s, range<const uint32_t*> idx, range<T*> d) {
+	SIMD_DISPATCH(template gather<T>(s.begin(), s.size(), idx.begin(), d.begin(), ::min(idx.size(), d.size())));
+}
+// d[idx[i]] = s[i]
+template<typename T> void scatter(range<const T*> s, range<const uint32_t*> idx, range<T*> d) {
+	SIMD_DISPATCH(template scatter<T>(s.begin(), idx.begin(), d.begin(), d.size(), ::min(idx.size(), s.size())));
+}
+
+#undef SIMD_DISPATCH
+
+} // namespace simd
+
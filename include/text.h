@@ -1,5 +1,7 @@
 #pragma once
 #include "base.h"
+#include <charconv>
+#include <limits>
 
 //-----------------------------------------------------------------------------
 //	text
@@ -67,12 +69,72 @@ template<typename T, typename R> T read_digits(R& r, int base = 10, int max_digi
 }
 
 template<typename T, typename R> T read_prefixed_digits(R& r) {
-	return !r.skip('0') ? read_digits<T>(r, 10)
-				: r.skip('b') ? read_digits<T>(r, 2)
-				: r.skip('x') ? read_digits<T>(r, 16)
+	typedef decltype(r.peek())	C;
+	return !r.skip(C('0')) ? read_digits<T>(r, 10)
+				: r.skip(C('b')) ? read_digits<T>(r, 2)
+				: r.skip(C('x')) ? read_digits<T>(r, 16)
 				: read_digits<T>(r, 8);
 }
 
+// as read_digits into an unsigned T, but false if the value does not fit (the digits are still consumed)
+template<typename T, typename R> bool read_digits_checked(R& r, T &val, int base = 10) {
+	bool	ok = true;
+	int		c;
+	val = 0;
+	while ((c = r.peek()) < 0x80 && is_alphanum(c)) {
+		int d = from_digit(c);
+		if (d >= base)
+			break;
+		if (val > (std::numeric_limits<T>::max() - d) / base)
+			ok = false;
+		val = val * base + d;
+		r.read();
+	}
+	return ok;
+}
+
+template<typename T, typename R> bool read_prefixed_checked(R& r, T &val) {
+	typedef decltype(r.peek())	C;
+	return !r.skip(C('0')) ? read_digits_checked(r, val, 10)
+				: r.skip(C('b')) ? read_digits_checked(r, val, 2)
+				: r.skip(C('x')) ? read_digits_checked(r, val, 16)
+				: read_digits_checked(r, val, 8);
+}
+
+// decimal digits of u, two at a time from a table; returns the start of the digits, which end at d
+template<typename C> C *put_decimal(uint64_t u, C *d) {
+	static const char	pairs[] =
+		"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+		"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+		"8081828384858687888990919293949596979899";
+	while (u >= 100) {
+		auto	i = (u % 100) * 2;
+		u /= 100;
+		*--d = pairs[i + 1];
+		*--d = pairs[i];
+	}
+	if (u >= 10) {
+		*--d = pairs[u * 2 + 1];
+		*--d = pairs[u * 2];
+	} else {
+		*--d = C('0' + u);
+	}
+	return d;
+}
+
+// shortest text that reads back as the same value (std::to_chars, which is Ryu-class on current standard libraries); returns the end
+template<typename C, typename T> C *put_float(T t, C *d, C *e) {
+	if constexpr (sizeof(C) == 1) {
+		return std::to_chars(d, e, t).ptr;
+	} else {
+		char	temp[32];
+		auto	n = std::to_chars(temp, end(temp), t).ptr - temp;
+		for (int i = 0; i < n; i++)
+			d[i] = temp[i];
+		return d + n;
+	}
+}
+
 //-----------------------------------------------------------------------------
 // TextReader
 //-----------------------------------------------------------------------------
@@ -135,9 +197,9 @@ template<typename C> struct TextReader {
 		return get(p, t2) && equal(t, t2);
 	}
 	template<typename T> Parser operator>>(T& t)	   { return get(skip_whitespace(), t) ? this : nullptr; }
-	template<typename T> Parser operator>>(const T& t) { return skip(skip_whitespace(), t) this : nullptr; }
-	template<typename T> Parser operator>=(T& t)	   { return get(r, t) ? this : nullptr; }
-	template<typename T> Parser operator>=(const T& t) { return skip(r, t) ? this : nullptr; }
+	template<typename T> Parser operator>>(const T& t) { return skip_whitespace().skip(t) ? this : nullptr; }
+	template<typename T> Parser operator>=(T& t)	   { return get(*this, t) ? this : nullptr; }
+	template<typename T> Parser operator>=(const T& t) { return skip(t) ? this : nullptr; }
 };
 #else
 
@@ -218,24 +280,57 @@ template<typename C> inline bool get(TextReader<C>& p, C& t) {
 	return false;
 }
 
-template<typename C> inline bool get(TextReader<C>& p, uint32_t& t) {
-	if (is_digit(p.peek())) {
-		t = read_prefixed_digits<uint32_t>(p);
+// integers are decimal, or binary, hex or octal with a 0b, 0x or 0 prefix; false if the value does not fit
+template<typename C, typename T> bool get_unsigned(TextReader<C>& p, T& t) {
+	T	u;
+	if (is_digit(p.peek()) && read_prefixed_checked(p, u)) {
+		t = u;
 		return true;
 	}
 	return false;
 }
 
-template<typename C> inline bool get(TextReader<C>& p, int& t) {
-	bool neg = p.skip('-');
-	if (is_digit(p.peek())) {
-		auto u 	= read_prefixed_digits<uint32_t>(p);
-		t		= neg ? -(int)u : (int)u;
+template<typename C, typename T> bool get_signed(TextReader<C>& p, T& t) {
+	typedef int_t<sizeof(T) * 8, false>	U;
+	bool	neg = p.skip(C('-'));
+	U		u;
+	if (is_digit(p.peek()) && read_prefixed_checked(p, u) && u <= U(std::numeric_limits<T>::max()) + neg) {
+		t = neg ? T(0 - u) : T(u);
 		return true;
 	}
 	return false;
 }
 
+template<typename C> inline bool get(TextReader<C>& p, uint32_t& t)	{ return get_unsigned(p, t); }
+template<typename C> inline bool get(TextReader<C>& p, uint64_t& t)	{ return get_unsigned(p, t); }
+template<typename C> inline bool get(TextReader<C>& p, int& t)		{ return get_signed(p, t); }
+template<typename C> inline bool get(TextReader<C>& p, int64_t& t)	{ return get_signed(p, t); }
+
+// the nearest float to the text (std::from_chars, which is Eisel-Lemire-class on current standard libraries); false if it is out of range
+template<typename C, typename T> bool get_float(TextReader<C>& p, T& t) {
+	if constexpr (sizeof(C) == 1) {
+		auto	r = std::from_chars(p.p, p.end, t);
+		if (r.ec != std::errc())
+			return false;
+		p.p = r.ptr;
+		return true;
+	} else {
+		// only ASCII can be part of a number, so narrow as much as could be, then skip what was used
+		char	temp[128];
+		size_t	n = 0;
+		for (auto i = p.p; i < p.end && n < sizeof(temp) && *i < 0x80 && (is_alphanum(char(*i)) || *i == '.' || *i == '-' || *i == '+'); ++i)
+			temp[n++] = char(*i);
+		auto	r = std::from_chars(temp, temp + n, t);
+		if (r.ec != std::errc())
+			return false;
+		p.p += r.ptr - temp;
+		return true;
+	}
+}
+
+template<typename C> inline bool get(TextReader<C>& p, float& t)	{ return get_float(p, t); }
+template<typename C> inline bool get(TextReader<C>& p, double& t)	{ return get_float(p, t); }
+
 template<typename C, typename R, typename T> bool get_limited(TextReader<C>& p, T& t) {
 	R	t2;
 	if (get(p, t2) && (T)t2 == t2) {
@@ -245,10 +340,10 @@ template<typename C, typename R, typename T> bool get_limited(TextReader<C>& p,
 	return false;
 }
 
-template<typename C> inline bool get(TextReader<C>& p, uint8_t& t)	{ return get_limited<uint32_t>(p, t); }
-template<typename C> inline bool get(TextReader<C>& p, uint16_t& t) { return get_limited<uint32_t>(p, t); }
-template<typename C> inline bool get(TextReader<C>& p, int8_t& t)	{ return get_limited<int>(p, t); }
-template<typename C> inline bool get(TextReader<C>& p, int16_t& t)	{ return get_limited<int>(p, t); }
+template<typename C> inline bool get(TextReader<C>& p, uint8_t& t)	{ return get_limited<C, uint32_t>(p, t); }
+template<typename C> inline bool get(TextReader<C>& p, uint16_t& t) { return get_limited<C, uint32_t>(p, t); }
+template<typename C> inline bool get(TextReader<C>& p, int8_t& t)	{ return get_limited<C, int>(p, t); }
+template<typename C> inline bool get(TextReader<C>& p, int16_t& t)	{ return get_limited<C, int>(p, t); }
 
 //-----------------------------------------------------------------------------
 // TextWriter
@@ -280,7 +375,7 @@ template<typename T, typename F> auto ifelse(bool b, const T& t, const F& f) {
 	};
 }
 
-void endl(TextWriter<wchar_t>& p) { p.write(L"\n", 1); p.flush(); };
+template<typename C> void endl(TextWriter<C>& p) { C c = '\n'; p.write(&c, 1); p.flush(); };
 
 template<typename C> inline		 	void put(TextWriter<C>& p, const _none&)		{}
 template<typename C> inline		 	void put(TextWriter<C>& p, C t)					{ p.write(&t, 1); }
@@ -288,19 +383,23 @@ template<typename C> inline		 	void put(TextWriter<C>& p, const C *t)			{ p.writ
 //template<typename C, int N> inline  void put(TextWriter<C>& p, const C (&t)[N])	{ p.write(t, N - 1); return p; }
 
 template<typename C, typename T> inline enable_if_t<is_integral_v<T> && !is_signed_v<T>> put(TextWriter<C>& p, const T &t) {
-	C	temp[(sizeof(T) * 5 + 1) / 2];
-	C*	d = end(temp);
-	T	i = t;
-	do {
-		*--d = to_digit(i % 10);
-		i /= 10;
-	} while (i);
+	C	temp[20];
+	C*	d = put_decimal(uint64_t(t), end(temp));
+	p.write(d, end(temp) - d);
+}
 
+// the magnitude is taken unsigned, so the most negative value has one too
+template<typename C, typename T> inline enable_if_t<is_integral_v<T> && is_signed_v<T>> put(TextWriter<C>& p, const T &t) {
+	C	temp[21];
+	C*	d = put_decimal(t < 0 ? 0 - uint64_t(t) : uint64_t(t), end(temp));
+	if (t < 0)
+		*--d = '-';
 	p.write(d, end(temp) - d);
 }
 
-template<typename C, typename T> inline enable_if_t<is_signed_v<T>> put(TextWriter<C>& p, const T &t) {
-	p << onlyif(t < 0, '-') << int_t<sizeof(T) * 8, false>(abs(t));
+template<typename C, typename T> inline enable_if_t<std::is_floating_point_v<T>> put(TextWriter<C>& p, const T &t) {
+	C	temp[32];
+	p.write(temp, put_float(t, temp, end(temp)) - temp);
 }
 
 template<typename C, typename F> exists_t<decltype(declval<F>()(declval<TextWriter<C>&>()))> put(TextWriter<C>& p, const F& f) {
@@ -310,5 +409,20 @@ template<typename C, typename F> exists_t<decltype(declval<F>()(declval<TextWrit
 template<typename C> inline void put(TextWriter<C> &p, const range<C*> &t)			{ p.write(t.begin(), t.size());	}
 template<typename C> inline void put(TextWriter<C> &p, const range<const C*> &t)	{ p.write(t.begin(), t.size());	}
 
-template<typename C> inline void put(TextWriter<C> &p, void *v)	{ p << L"0x" << base<16>(intptr_t(v));	}
+template<typename C> inline void put(TextWriter<C> &p, void *v)	{
+	C	temp[sizeof(void*) * 2];
+	p << C('0') << C('x') << range<const C*>(put_digits<16>(uintptr_t(v), end(temp)), end(temp));
+}
+
+//-----------------------------------------------------------------------------
+// BlockWriter - accumulates output in memory
+//-----------------------------------------------------------------------------
+
+template<typename C> struct BlockWriter : TextWriter<C> {
+	growing_block<C>	block;
+	BlockWriter(size_t reserve = 4096) : block(reserve) {}
+	size_t	write(const C* buffer, size_t size) override { memcpy(block.alloc(size), buffer, size * sizeof(C)); return size; }
+	range<C*>	data()	const	{ return {block.begin(), block.p}; }
+	size_t		size()	const	{ return block.tell(); }
+};
 